@@ -11,23 +11,24 @@ greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = Shannon-Fano-Kodierung
 TEMPLATE = app
 
-QMAKE_CXXFLAGS += -std=c++11
+QMAKE_CXXFLAGS += -std=c++14
 
 SOURCES += main.cpp\
         mainwindow.cpp \
     sfcodec.cpp \
-    symbol.cpp \
-    sflist.cpp \
-    sftreenode.cpp
+    sftreenode.cpp \
+    sfframestats.cpp
 
 HEADERS  += mainwindow.h \
     sfcodec.h \
-    symbol.h \
-    sflist.h \
-    sftreenode.h
+    sftreenode.h \
+    sfframestats.h
+
+include(sfcore.pri)
 
 FORMS    += mainwindow.ui
 
 OTHER_FILES += \
+    sfc.pro \
     README.txt \
     LICENSE.txt
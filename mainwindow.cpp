@@ -1,6 +1,13 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QFileInfo>
+
+#include "sfcodetable.h"
+
 
 /**
  * @brief MainWindow::MainWindow sets up the UI at the start of the program.
@@ -13,7 +20,8 @@
  */
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
-    ui(new Ui::MainWindow)
+    ui(new Ui::MainWindow),
+    fileBits(0)
 {
     ui->setupUi(this);
     codec = std::unique_ptr<SFCodec>(new SFCodec(ui->inputField));
@@ -26,10 +34,32 @@ MainWindow::MainWindow(QWidget *parent) :
     ui->statusBar->show();
     ui->statusBar->showMessage("Ready",2000);
 
+    for(const SFCodeBuilder* builder:SFCodeBuilder::builders())
+        ui->builderCombo->addItem(builder->name());
+
+    fileProgress = new QProgressBar(this);
+    fileProgress->setRange(0, 100);
+    fileProgress->hide();
+    cancelButton = new QPushButton("Cancel", this);
+    cancelButton->hide();
+    ui->statusBar->addPermanentWidget(fileProgress);
+    ui->statusBar->addPermanentWidget(cancelButton);
+    fileTimer.setInterval(50);
+
+    frameOverlay = new QLabel(ui->treeView);
+    frameOverlay->setStyleSheet("background-color: rgba(255, 255, 255, 220); font-family: monospace;");
+    frameOverlay->move(5, 5);
+    frameOverlay->hide();
+
     QObject::connect(ui->StepButton, SIGNAL(clicked()),this,SLOT(on_stepButton_clicked()));
     QObject::connect(ui->PrevStepButton, SIGNAL(clicked()), this, SLOT(on_prevStepButton_clicked()));
     QObject::connect(ui->autoStepCheck, SIGNAL(clicked()), this, SLOT(on_autoStepCheck_clicked()));
     QObject::connect(ui->smallStepCheck, SIGNAL(clicked()), this, SLOT(on_smallStepCheck_clicked()));
+    QObject::connect(ui->builderCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(builderChanged(int)));
+    QObject::connect(ui->actionOpenFile, SIGNAL(triggered()), this, SLOT(openFile()));
+    QObject::connect(cancelButton, SIGNAL(clicked()), this, SLOT(cancelFile()));
+    QObject::connect(&fileTimer, SIGNAL(timeout()), this, SLOT(updateFileProgress()));
+    QObject::connect(ui->actionFrameTimes, SIGNAL(toggled(bool)), this, SLOT(showFrameTimes(bool)));
 
 }
 
@@ -43,17 +73,14 @@ void MainWindow::on_inputField_textChanged()
 {
     if(textBuffer != ui->inputField->toPlainText())
     {
+        fileName.clear();
         codec->updateIndex();
         ui->outputField->setText(codec->encode());
         updateBin();
         updateStatus();
         updateTable();
         textBuffer = ui->inputField->toPlainText();
-
-        codeTree = std::make_shared<SFTreeNode>(codec->getIndex());
-        if(ui->autoStepCheck->isChecked())
-            while(codeTree->step());
-        ui->treeView->setPixmap(QPixmap::fromImage(SFTreeNode::drawTree(codeTree,ui->treeView->width(), ui->treeView->height())));
+        updateCodeTree();
     }
 }
 
@@ -67,11 +94,15 @@ void MainWindow::on_stepButton_clicked()
 {
     if(codeTree)
     {
+        frameStats.begin(ui->smallStepCheck->isChecked() ? "small step" : "step");
+        QElapsedTimer timer;
+        timer.start();
         if(ui->smallStepCheck->isChecked())
             codeTree->smallStep();
         else
             codeTree->step();
-        ui->treeView->setPixmap(QPixmap::fromImage(SFTreeNode::drawTree(codeTree,ui->treeView->width(), ui->treeView->height())));
+        frameStats.add(SFFrameStats::STEP, timer.nsecsElapsed());
+        updateTreeView();
     }
 }
 
@@ -85,8 +116,12 @@ void MainWindow::on_prevStepButton_clicked()
 {
     if(codeTree)
     {
+        frameStats.begin("step back");
+        QElapsedTimer timer;
+        timer.start();
         codeTree->step_back();
-        ui->treeView->setPixmap(QPixmap::fromImage(SFTreeNode::drawTree(codeTree,ui->treeView->width(), ui->treeView->height())));
+        frameStats.add(SFFrameStats::STEP, timer.nsecsElapsed());
+        updateTreeView();
     }
 }
 
@@ -102,21 +137,26 @@ void MainWindow::on_autoStepCheck_clicked()
     ui->PrevStepButton->setDisabled(ui->autoStepCheck->isChecked());
     ui->smallStepCheck->setDisabled(ui->autoStepCheck->isChecked());
 
-    if(codeTree && ui->autoStepCheck->isChecked())
+    if(!codeTree)
+        return;
+
+    frameStats.begin(ui->autoStepCheck->isChecked() ? "all steps" : "all steps back");
+    QElapsedTimer timer;
+    timer.start();
+    if(ui->autoStepCheck->isChecked())
     {
         while(codeTree->step())
         {
         }
-        updateTreeView();
     }
     else
     {
         while(codeTree->step_back())
         {
         }
-        updateTreeView();
     }
-    ui->treeView->setPixmap(QPixmap::fromImage(SFTreeNode::drawTree(codeTree,ui->treeView->width(), ui->treeView->height())));
+    frameStats.add(SFFrameStats::STEP, timer.nsecsElapsed());
+    updateTreeView();
 }
 
 /**
@@ -129,6 +169,156 @@ void MainWindow::on_smallStepCheck_clicked()
     ui->autoStepCheck->setDisabled(ui->smallStepCheck->isChecked());
 }
 
+/**
+ * @brief MainWindow::builderChanged called when an other algorithm was selected in the combo box
+ * @param p_index index of the selected builder in SFCodeBuilder::builders()
+ *
+ * The codes, the table and the code tree are rebuilt with the new algorithm
+ */
+void MainWindow::builderChanged(int p_index)
+{
+    QList<const SFCodeBuilder*> builders = SFCodeBuilder::builders();
+    if(p_index < 0 || p_index >= builders.size())
+        return;
+
+    codec->setBuilder(builders.at(p_index));
+    if(!fileName.isEmpty())
+    {
+        buildFileCodes();
+        showFile();
+        return;
+    }
+    textBuffer.clear();             //forces on_inputField_textChanged() to update everything
+    on_inputField_textChanged();
+}
+
+/**
+ * @brief MainWindow::openFile asks for a file and starts counting it in the background
+ *
+ * The file is never loaded into the input field. SFFileAnalyzer maps it and builds the codes on
+ * its own thread while updateFileProgress() shows the progress, showFile() shows the result.
+ */
+void MainWindow::openFile()
+{
+    QString name = QFileDialog::getOpenFileName(this, "Open file");
+    if(name.isEmpty())
+        return;
+
+    if(!fileAnalyzer.start(name, *codec->getBuilder()))
+    {
+        ui->statusBar->showMessage("Can not open " + name, 5000);
+        return;
+    }
+    fileProgress->setValue(0);
+    fileProgress->show();
+    cancelButton->show();
+    ui->statusBar->showMessage("Analyzing " + QFileInfo(name).fileName());
+    fileTimer.start();
+}
+
+/**
+ * @brief MainWindow::cancelFile stops the analysis of the opened file, the shown codes are kept
+ */
+void MainWindow::cancelFile()
+{
+    fileAnalyzer.cancel();
+}
+
+/**
+ * @brief MainWindow::updateFileProgress called by fileTimer while a file is analyzed
+ *
+ * Updates the progress bar and shows the file once the analysis is done.
+ */
+void MainWindow::updateFileProgress()
+{
+    switch(fileAnalyzer.state())
+    {
+    case SFFileAnalyzer::RUNNING:
+        if(fileAnalyzer.size() > 0)
+            fileProgress->setValue(int(fileAnalyzer.bytesDone()*100/fileAnalyzer.size()));
+        return;
+    case SFFileAnalyzer::DONE:
+        fileName = fileAnalyzer.fileName();
+        fileHistogram = fileAnalyzer.histogram();
+        if(&fileAnalyzer.builder() == codec->getBuilder())
+        {
+            codec->setIndex(fileAnalyzer.index());
+            fileBits = fileAnalyzer.encodedBits();
+        }
+        else                        //the builder was changed while counting
+            buildFileCodes();
+        showFile();
+        break;
+    case SFFileAnalyzer::CANCELED:
+        ui->statusBar->showMessage("Canceled", 2000);
+        break;
+    default:
+        ui->statusBar->showMessage("Can not read " + fileAnalyzer.fileName(), 5000);
+        break;
+    }
+
+    fileTimer.stop();
+    fileProgress->hide();
+    cancelButton->hide();
+}
+
+/**
+ * @brief MainWindow::buildFileCodes builds the codes of the opened file with the selected builder
+ *
+ * The codes are shown even if some are longer than 64 bits, but then no table can be built from
+ * them and fileBits is SFCodeTable::NO_CODE (see showFile()).
+ */
+void MainWindow::buildFileCodes()
+{
+    codec->setIndex(SFCodeTable::indexOfHistogram(fileHistogram, *codec->getBuilder()));
+    fileBits = SFCodeTable::fromIndex(codec->getIndex(), fileHistogram.size()).cost(fileHistogram);
+}
+
+/**
+ * @brief MainWindow::showFile shows the codes of the opened file
+ *
+ * The table, the code tree and the status bar are filled from the index of the file. The text
+ * fields are cleared since they would hold the whole file.
+ */
+void MainWindow::showFile()
+{
+    ui->inputField->blockSignals(true);
+    ui->inputField->clear();
+    ui->inputField->blockSignals(false);
+    textBuffer.clear();
+    ui->outputField->clear();
+    ui->textbinary_field->clear();
+
+    updateTable();
+    updateCodeTree();
+
+    qint64 size = 0;
+    for(quint64 count:fileHistogram)
+        size += count;
+    QString message = QFileInfo(fileName).fileName() + ": " + QString::number(size) + " bytes, ";
+    if(fileBits == SFCodeTable::NO_CODE)
+        message += QString("codes longer than 64 bits can not be encoded");
+    else if(size > 0)
+        message += QString::number((double)fileBits*100/(double)(8*size)) + QString("%");
+    message += " (" + codec->getBuilder()->name() + ")";
+    ui->statusBar->showMessage(message);
+}
+
+/**
+ * @brief MainWindow::updateCodeTree builds the code tree of the current index and draws it
+ */
+void MainWindow::updateCodeTree()
+{
+    frameStats.begin("new tree");
+    QElapsedTimer timer;
+    timer.start();
+    codeTree = std::make_shared<SFTreeNode>(codec->getIndex());
+    if(ui->autoStepCheck->isChecked())
+        while(codeTree->step());
+    frameStats.add(SFFrameStats::STEP, timer.nsecsElapsed());
+    updateTreeView();
+}
+
 /**
  * @brief MainWindow::updateTable updates the table on the right side to represent the current state
  */
@@ -137,7 +327,7 @@ void MainWindow::updateTable()
     if(codec)
     {
         QTableWidget* table = ui->key_table;
-        SFList index = codec->getIndex();
+        const SFList& index = codec->getIndex();
 
         table->setColumnCount(4);
         table->setRowCount(index.size());
@@ -164,9 +354,42 @@ void MainWindow::updateTable()
     }
 }
 
+/**
+ * @brief MainWindow::updateTreeView draws the code tree and ends the frame started by the action
+ *
+ * The time of drawTree() (depth() and painting) and of converting the image into the pixmap of
+ * the label are added to frameStats.
+ */
 void MainWindow::updateTreeView()
 {
-    ui->treeView->setPixmap(QPixmap::fromImage(SFTreeNode::drawTree(codeTree,ui->treeView->width(), ui->treeView->height())));
+    SFTreeNode::DrawStats draw_stats;
+    QImage image = SFTreeNode::drawTree(codeTree, ui->treeView->width(), ui->treeView->height(), &draw_stats);
+    QElapsedTimer timer;
+    timer.start();
+    ui->treeView->setPixmap(QPixmap::fromImage(image));
+    frameStats.add(SFFrameStats::DEPTH, draw_stats.depth_nsecs);
+    frameStats.add(SFFrameStats::PAINT, draw_stats.paint_nsecs);
+    frameStats.add(SFFrameStats::UPLOAD, timer.nsecsElapsed());
+    frameStats.end(codeTree ? int(codeTree->nodeCount()) : 0, codec->getIndex().size());
+
+    if(ui->actionFrameTimes->isChecked() && frameStats.frames() > 0)
+    {
+        qDebug().noquote() << frameStats.describe(frameStats.last());
+        frameOverlay->setText(frameStats.report());
+        frameOverlay->adjustSize();
+    }
+}
+
+/**
+ * @brief MainWindow::showFrameTimes shows or hides the frame times on top of the tree view
+ *
+ * While they are shown every frame is also logged with qDebug().
+ */
+void MainWindow::showFrameTimes(bool p_show)
+{
+    frameOverlay->setText(frameStats.report());
+    frameOverlay->adjustSize();
+    frameOverlay->setVisible(p_show);
 }
 
 void MainWindow::updateBin()
@@ -187,6 +410,7 @@ void MainWindow::updateStatus()
             outputBin = ui->textbinary_field->toPlainText();
 
     message = QString::number((double)outputText.length()*100/(double)outputBin.length()) + QString("%");
+    message += " (" + codec->getBuilder()->name() + ")";
     ui->statusBar->showMessage(message);
 }
 
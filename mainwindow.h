@@ -1,12 +1,19 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include <QLabel>
 #include <QMainWindow>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QString>
+#include <QTimer>
+#include <QVector>
 
 #include <memory>
 
 #include "sfcodec.h"
+#include "sffileanalyzer.h"
+#include "sfframestats.h"
 #include "sftreenode.h"
 
 namespace Ui {
@@ -29,12 +36,31 @@ private slots:
     void on_prevStepButton_clicked();
     void on_autoStepCheck_clicked();
     void on_smallStepCheck_clicked();
+    void builderChanged(int p_index);
+    void openFile();
+    void cancelFile();
+    void updateFileProgress();
+    void showFrameTimes(bool p_show);
 private:
     Ui::MainWindow *ui;
     std::unique_ptr<SFCodec> codec;
     QString textBuffer; //for some reason the SIGNAL textChanged is emitted multiple time. textBuffer is needed for a workaround
     std::shared_ptr<SFTreeNode> codeTree;
 
+    SFFileAnalyzer fileAnalyzer;    //counts an opened file in the background
+    QTimer fileTimer;               //polls fileAnalyzer while it runs
+    QProgressBar* fileProgress;
+    QPushButton* cancelButton;
+    QString fileName;               //the file that is shown, empty if the input field is shown
+    QVector<quint64> fileHistogram;
+    quint64 fileBits;               //size of the file encoded with the shown codes, SFCodeTable::NO_CODE if they can not be encoded
+
+    SFFrameStats frameStats;        //times of the steps and of drawing the tree
+    QLabel* frameOverlay;           //shows frameStats on top of the tree view
+
+    void buildFileCodes();
+    void showFile();
+    void updateCodeTree();
     void updateTable();
     void updateTreeView();
     void updateCode();
@@ -0,0 +1,210 @@
+#include "sfadaptivecodec.h"
+
+#include <algorithm>
+
+/**
+ * @brief SFAdaptiveModel::SFAdaptiveModel sets up the initial distribution
+ * @param p_model optional SFList with initial counts of byte symbols. Symbols that are
+ * missing in p_model (or if p_model is empty all symbols) start with a count of one
+ * @param p_builder the algorithm that assigns the codes
+ */
+SFAdaptiveModel::SFAdaptiveModel(const SFList& p_model, const SFCodeBuilder& p_builder):
+    m_builder(&p_builder),
+    m_list(flatModel()),
+    m_position(ALPHABET_SIZE, 0),
+    m_table(ALPHABET_SIZE),
+    m_total(0),
+    m_interval(REBUILD_INTERVAL_MIN),
+    m_since_rebuild(0)
+{
+    for(const Symbol& sym:p_model)
+    {
+        int t_sym = sym.getSym().unicode();
+        if(t_sym < END_OF_STREAM && sym.getCount() > 0)
+            m_list[t_sym].setCount(sym.getCount());
+    }
+
+    //the order has to be deterministic because the decoder has to build the same list
+    m_list.sortByCount();
+
+    for(int i = 0; i < m_list.size(); i++)
+    {
+        m_position[m_list.at(i).getSym().unicode()] = i;
+        m_total += m_list.at(i).getCount();
+    }
+    while(m_total >= COUNT_LIMIT)
+        halveCounts();
+
+    rebuild();
+}
+
+/**
+ * @brief SFAdaptiveModel::flatModel creates a list of all byte values and the end of stream symbol
+ * @return SFList with ALPHABET_SIZE symbols ordered by their value, each with a count of one
+ */
+SFList SFAdaptiveModel::flatModel()
+{
+    SFList list;
+    for(int i = 0; i < ALPHABET_SIZE; i++)
+    {
+        list.append(Symbol(QChar(ushort(i))));
+        list.last().setCount(1);
+    }
+    return list;
+}
+
+/**
+ * @brief SFAdaptiveModel::update counts one occurence of p_symbol and rebuilds the codes if it is due
+ * @param p_symbol the symbol that was just encoded or decoded
+ */
+void SFAdaptiveModel::update(int p_symbol)
+{
+    int pos = m_position.at(p_symbol);
+    m_list[pos].setCount(m_list.at(pos).getCount() + 1);
+    m_total++;
+
+    while(pos > 0 && m_list.at(pos-1).getCount() < m_list.at(pos).getCount())  //keep the list sorted
+    {
+        m_list.swap(pos-1, pos);
+        m_position[m_list.at(pos).getSym().unicode()] = pos;
+        pos--;
+    }
+    m_position[p_symbol] = pos;
+
+    if(m_total >= COUNT_LIMIT)
+        halveCounts();
+
+    if(++m_since_rebuild >= m_interval)
+    {
+        rebuild();
+        m_interval = std::min(2*m_interval, int(REBUILD_INTERVAL_MAX));
+    }
+}
+
+/**
+ * @brief SFAdaptiveModel::rebuild assigns new codes to the (already sorted) list
+ *
+ * The builder works on a copy because it may reorder the symbols. The codes of m_list
+ * are always empty and the builders only use the counts. If a code would be longer than
+ * 64 bits the Huffman builder assigns the codes instead (like SFCodeTable::fromHistogram()),
+ * encoder and decoder do that at the same symbol.
+ */
+void SFAdaptiveModel::rebuild()
+{
+    SFList index = m_list;
+    m_builder->build(index);
+    m_table = SFCodeTable::fromIndex(index, ALPHABET_SIZE);
+    if(m_table.isEmpty())
+    {
+        index = m_list;
+        SFCodeBuilder::huffman().build(index);
+        m_table = SFCodeTable::fromIndex(index, ALPHABET_SIZE);
+    }
+    m_since_rebuild = 0;
+}
+
+/**
+ * @brief SFAdaptiveModel::halveCounts halves all counts (rounding up) so recent symbols weigh more
+ *
+ * Rounding up keeps every count above zero and does not change the order of the list.
+ */
+void SFAdaptiveModel::halveCounts()
+{
+    m_total = 0;
+    for(Symbol& sym:m_list)
+    {
+        sym.setCount((sym.getCount() + 1)/2);
+        m_total += sym.getCount();
+    }
+}
+
+
+SFAdaptiveEncoder::SFAdaptiveEncoder(const SFList& p_model, const SFCodeBuilder& p_builder):
+    m_model(p_model, p_builder),
+    m_out(),
+    m_writer(&m_out),
+    m_finished(false)
+{
+
+}
+
+/**
+ * @brief SFAdaptiveEncoder::encode encodes the next chunk of the input
+ * @param p_chunk the next bytes of the input
+ * @return the encoded bytes that are complete. Bits of an incomplete byte are kept until the next call
+ */
+QByteArray SFAdaptiveEncoder::encode(const QByteArray& p_chunk)
+{
+    Q_ASSERT(!m_finished);
+
+    for(const char character:p_chunk)
+    {
+        int sym = uchar(character);
+        m_model.table().encode(m_writer, sym);
+        m_model.update(sym);
+    }
+
+    QByteArray result = m_out;
+    m_out.clear();
+    return result;
+}
+
+/**
+ * @brief SFAdaptiveEncoder::finish terminates the stream
+ * @return the remaining bytes including the end of stream symbol
+ */
+QByteArray SFAdaptiveEncoder::finish()
+{
+    if(!m_finished)
+    {
+        m_model.table().encode(m_writer, SFAdaptiveModel::END_OF_STREAM);
+        m_writer.flush();
+        m_finished = true;
+    }
+
+    QByteArray result = m_out;
+    m_out.clear();
+    return result;
+}
+
+
+SFAdaptiveDecoder::SFAdaptiveDecoder(const SFList& p_model, const SFCodeBuilder& p_builder):
+    m_model(p_model, p_builder),
+    m_node(SFCodeTable::root()),
+    m_finished(false)
+{
+
+}
+
+/**
+ * @brief SFAdaptiveDecoder::decode decodes the next chunk of the encoded stream
+ * @param p_chunk the next bytes of the encoded stream
+ * @return the decoded bytes. Everything behind the end of stream symbol is ignored
+ */
+QByteArray SFAdaptiveDecoder::decode(const QByteArray& p_chunk)
+{
+    QByteArray result;
+    SFBitReader reader(p_chunk);
+    int bit;
+
+    while(!m_finished && (bit = reader.readBit()) >= 0)
+    {
+        m_node = m_model.table().child(m_node, bit);
+        if(SFCodeTable::isLeaf(m_node))
+        {
+            int sym = SFCodeTable::leafSymbol(m_node);
+            m_node = SFCodeTable::root();
+
+            if(sym == SFAdaptiveModel::END_OF_STREAM)
+            {
+                m_finished = true;
+            }
+            else
+            {
+                result.append(char(sym));
+                m_model.update(sym);
+            }
+        }
+    }
+    return result;
+}
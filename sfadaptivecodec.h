@@ -0,0 +1,96 @@
+#ifndef SFADAPTIVECODEC_H
+#define SFADAPTIVECODEC_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "sflist.h"
+#include "sfcodetable.h"
+#include "sfbitstream.h"
+
+/**
+ * \class SFAdaptiveModel
+ * @brief Symbol statistics shared by SFAdaptiveEncoder and SFAdaptiveDecoder
+ *
+ * The model starts with a flat (or supplied) distribution over all 256 byte values
+ * plus an end of stream symbol. Every coded symbol increments its count. The list
+ * is kept sorted by moving the symbol towards the front while its count is bigger
+ * than the one of its predecessor, so rebuilding the codes never needs a full sort.
+ * The codes are rebuilt after a deterministic number of symbols which doubles after
+ * every rebuild (up to REBUILD_INTERVAL_MAX). Encoder and decoder perform exactly the
+ * same updates and therefore always use identical code tables.
+ */
+class SFAdaptiveModel
+{
+public:
+    enum {ALPHABET_SIZE = 257, END_OF_STREAM = 256};
+
+    explicit SFAdaptiveModel(const SFList& p_model = SFList(), const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+
+    static SFList flatModel();
+
+    const SFCodeTable& table() const {return m_table;}
+    void update(int p_symbol);
+
+private:
+    static const int REBUILD_INTERVAL_MIN = 64;
+    static const int REBUILD_INTERVAL_MAX = 8192;
+    static const qint64 COUNT_LIMIT = qint64(1) << 24;     //counts are halved when the total reaches this limit
+
+    void rebuild();
+    void halveCounts();
+
+    const SFCodeBuilder* m_builder;
+    SFList m_list;
+    QVector<int> m_position;    //position of every symbol in m_list
+    SFCodeTable m_table;
+    qint64 m_total;
+    int m_interval;
+    int m_since_rebuild;
+};
+
+/**
+ * \class SFAdaptiveEncoder
+ * @brief One pass Shannon Fano encoder for data that can not be scanned in advance
+ *
+ * encode() can be called with consecutive chunks of the input and returns the bytes
+ * that are complete so far. finish() terminates the stream with the end of stream
+ * symbol and returns the remaining bytes.
+ */
+class SFAdaptiveEncoder
+{
+public:
+    explicit SFAdaptiveEncoder(const SFList& p_model = SFList(), const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+
+    QByteArray encode(const QByteArray& p_chunk);
+    QByteArray finish();
+
+private:
+    SFAdaptiveModel m_model;
+    QByteArray m_out;
+    SFBitWriter m_writer;
+    bool m_finished;
+};
+
+/**
+ * \class SFAdaptiveDecoder
+ * @brief Decodes the output of SFAdaptiveEncoder chunk by chunk
+ *
+ * The decoder has to be constructed with the same model and builder as the encoder.
+ * Codes may be split between chunks, the decoder keeps its position in the code tree.
+ */
+class SFAdaptiveDecoder
+{
+public:
+    explicit SFAdaptiveDecoder(const SFList& p_model = SFList(), const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+
+    QByteArray decode(const QByteArray& p_chunk);
+    bool atEnd() const {return m_finished;}
+
+private:
+    SFAdaptiveModel m_model;
+    int m_node;             //current position in the decode tree of m_model
+    bool m_finished;
+};
+
+#endif // SFADAPTIVECODEC_H
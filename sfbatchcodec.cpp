@@ -0,0 +1,262 @@
+#include "sfbatchcodec.h"
+
+#include <QtEndian>
+
+#include <limits>
+#include <vector>
+
+SFBatchEncoder::SFBatchEncoder():
+    m_model(0),
+    m_builder(&SFCodeBuilder::shannonFano())
+{
+
+}
+
+/**
+ * @brief SFBatchEncoder::encode encodes a list of messages into one batch
+ * @return the batch
+ */
+QByteArray SFBatchEncoder::encode(const QVector<QByteArray>& p_messages) const
+{
+    QByteArray data;
+    QVector<quint32> offsets(1, 0);
+    for(const QByteArray& message:p_messages)
+    {
+        data.append(message);
+        offsets.append(quint32(data.size()));
+    }
+
+    QByteArray result;
+    encode(data.constData(), offsets.constData(), p_messages.size(), result);
+    return result;
+}
+
+/**
+ * @brief SFBatchEncoder::encode encodes messages stored behind each other in one buffer
+ * @param p_data buffer holding the messages
+ * @param p_offsets p_count + 1 offsets, message i is p_data[p_offsets[i]] to p_data[p_offsets[i+1] - 1]
+ * @param p_count number of messages
+ * @param p_out the batch is appended to this array
+ *
+ * The size of the codes of every message is calculated from the code lengths first, so every
+ * message is written directly to its place in the output. If the model has no code for a byte
+ * of the messages a table is built for the batch instead.
+ */
+void SFBatchEncoder::encode(const char* p_data, const quint32* p_offsets, int p_count, QByteArray& p_out) const
+{
+    const char* data = p_data + p_offsets[0];
+    qint64 size = qint64(p_offsets[p_count]) - p_offsets[0];
+
+    QVector<quint64> histogram = SFCodeTable::histogram(data, size);
+    SFCodeTable table = m_model;
+    quint8 flags = SFBlockHeader::EXTERNAL_TABLE;
+    if(m_model.isEmpty() || m_model.cost(histogram) == SFCodeTable::NO_CODE)
+    {
+        table = SFCodeTable::fromHistogram(histogram, *m_builder);
+        flags = size > 0 ? SFBlockHeader::NEW_TABLE : 0;
+    }
+
+    SFBitWriter writer(&p_out);
+    writer.writeBits(flags, 8);
+    writer.writeBits(quint32(p_count), 32);
+    if(flags & SFBlockHeader::NEW_TABLE)
+        table.write(writer);
+    writer.flush();
+
+    uchar lengths[256];
+    for(int symbol = 0; symbol < 256; symbol++)
+        lengths[symbol] = uchar(symbol < table.alphabetSize() ? table.code(symbol).length : 0);
+
+    std::vector<qint64> ends(p_count);
+    qint64 total = 0;
+    for(int m = 0; m < p_count; m++)
+    {
+        const uchar* message = reinterpret_cast<const uchar*>(p_data + p_offsets[m]);
+        qint64 bits = 0;
+        for(quint32 i = 0; i < p_offsets[m+1] - p_offsets[m]; i++)
+            bits += lengths[message[i]];
+        total += (bits + 7)/8;
+        ends[m] = total;
+    }
+    Q_ASSERT(total <= qint64(std::numeric_limits<quint32>::max()));
+
+    for(int m = 0; m < p_count; m++)
+        writer.writeBits(p_offsets[m+1] - p_offsets[m], 32);
+    for(int m = 0; m < p_count; m++)
+        writer.writeBits(quint64(ends[m]), 32);
+
+    char* codes = writer.reserve(total);
+    for(int m = 0; m < p_count; m++)
+    {
+        qint64 begin = m > 0 ? ends[m-1] : 0;
+        SFBitWriter message_writer(codes + begin, ends[m] - begin);
+        for(quint32 i = p_offsets[m]; i < p_offsets[m+1]; i++)
+            table.encode(message_writer, uchar(p_data[i]));
+        message_writer.flush();
+    }
+}
+
+
+SFBatchDecoder::SFBatchDecoder():
+    m_model(0),
+    m_table(0),
+    m_count(0),
+    m_ends(0),
+    m_codes(0),
+    m_offsets(1, 0)
+{
+
+}
+
+/**
+ * @brief SFBatchDecoder::open reads the table and the offsets of a batch
+ * @return false if the batch is corrupted or was encoded with a model that was not set
+ */
+bool SFBatchDecoder::open(const char* p_batch, qint64 p_size)
+{
+    m_count = 0;
+    m_offsets.fill(0, 1);
+    m_table = SFCodeTable(0);
+
+    if(p_size < 5)
+        return false;
+    SFBitReader reader(p_batch, p_size);
+    quint8 flags = quint8(reader.readBits(8));
+    quint32 count = quint32(reader.readBits(32));
+    if(flags & SFBlockHeader::NEW_TABLE)
+        m_table = SFCodeTable::read(reader);
+    else if(flags & SFBlockHeader::EXTERNAL_TABLE)
+        m_table = m_model;
+    reader.alignToByte();
+
+    qint64 arrays = reader.bytePos();
+    if(arrays > p_size || count > quint64(p_size - arrays)/8)
+        return false;
+
+    const uchar* sizes = reinterpret_cast<const uchar*>(p_batch + arrays);
+    const uchar* ends = sizes + 4*qint64(count);
+    qint64 codes_size = p_size - arrays - 8*qint64(count);
+    QVector<qint64> offsets(int(count) + 1, 0);
+    quint32 end = 0;
+    for(quint32 m = 0; m < count; m++)
+    {
+        quint32 next = qFromBigEndian<quint32>(ends + 4*m);
+        if(next < end || next > codes_size)
+            return false;
+        end = next;
+        offsets[int(m) + 1] = offsets.at(int(m)) + qFromBigEndian<quint32>(sizes + 4*m);
+    }
+    if(offsets.last() > 0 && m_table.isEmpty())
+        return false;
+
+    m_count = int(count);
+    m_ends = ends;
+    m_codes = reinterpret_cast<const char*>(ends + 4*qint64(count));
+    m_offsets = offsets;
+    return true;
+}
+
+/**
+ * @brief SFBatchDecoder::codes returns a reader for the codes of a message
+ */
+SFBitReader SFBatchDecoder::codes(int p_index) const
+{
+    quint32 begin = p_index > 0 ? qFromBigEndian<quint32>(m_ends + 4*(p_index - 1)) : 0;
+    return SFBitReader(m_codes + begin, qFromBigEndian<quint32>(m_ends + 4*p_index) - begin);
+}
+
+/**
+ * @brief SFBatchDecoder::decodeMessage decodes a single message
+ * @param p_out buffer for messageSize(p_index) bytes
+ * @return false if the message is corrupted
+ */
+bool SFBatchDecoder::decodeMessage(int p_index, char* p_out) const
+{
+    SFBitReader reader = codes(p_index);
+    quint32 size = messageSize(p_index);
+    for(quint32 i = 0; i < size; i++)
+    {
+        int sym = m_table.decode(reader);
+        if(sym < 0)
+            return false;
+        p_out[i] = char(sym);
+    }
+    return true;
+}
+
+/**
+ * @brief SFBatchDecoder::decodeAll decodes all messages behind each other
+ * @param p_out buffer for decodedSize() bytes, message i starts at messageOffset(i)
+ * @return false if a message is corrupted
+ *
+ * The messages are decoded in groups of LANES. The main loop decodes one symbol of every message
+ * of the group per iteration until the shortest one is complete, the rest of the others is decoded
+ * one by one.
+ */
+bool SFBatchDecoder::decodeAll(char* p_out) const
+{
+    int m = 0;
+    for(; m + LANES <= m_count; m += LANES)
+    {
+        static_assert(LANES == 4, "one reader per lane");
+        SFBitReader readers[LANES] = {codes(m), codes(m+1), codes(m+2), codes(m+3)};
+        char* out[LANES];
+        quint32 rounds = ~quint32(0);
+        for(int lane = 0; lane < LANES; lane++)
+        {
+            out[lane] = p_out + m_offsets.at(m + lane);
+            rounds = qMin(rounds, messageSize(m + lane));
+        }
+
+        bool ok = true;
+        for(quint32 i = 0; i < rounds; i++)
+        {
+            for(int lane = 0; lane < LANES; lane++)
+            {
+                int sym = m_table.decode(readers[lane]);
+                ok &= (sym >= 0);
+                out[lane][i] = char(sym);
+            }
+            if(!ok)
+                return false;
+        }
+
+        for(int lane = 0; lane < LANES; lane++)
+        {
+            for(quint32 i = rounds; i < messageSize(m + lane); i++)
+            {
+                int sym = m_table.decode(readers[lane]);
+                if(sym < 0)
+                    return false;
+                out[lane][i] = char(sym);
+            }
+        }
+    }
+    for(; m < m_count; m++)
+    {
+        if(!decodeMessage(m, p_out + m_offsets.at(m)))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief SFBatchDecoder::decode decodes a batch into a list of messages
+ * @return false if the batch is corrupted
+ */
+bool SFBatchDecoder::decode(const QByteArray& p_batch, QVector<QByteArray>& p_messages)
+{
+    p_messages.clear();
+    if(!open(p_batch.constData(), p_batch.size()) || decodedSize() > std::numeric_limits<int>::max())
+        return false;
+
+    QByteArray data;
+    data.resize(int(decodedSize()));
+    if(!decodeAll(data.data()))
+        return false;
+
+    p_messages.reserve(m_count);
+    for(int m = 0; m < m_count; m++)
+        p_messages.append(data.mid(int(m_offsets.at(m)), int(messageSize(m))));
+    return true;
+}
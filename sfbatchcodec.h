@@ -0,0 +1,85 @@
+#ifndef SFBATCHCODEC_H
+#define SFBATCHCODEC_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "sfcodetable.h"
+#include "sfbitstream.h"
+#include "sfblockcodec.h"
+
+/**
+ * \class SFBatchEncoder
+ * @brief Encodes many small messages (log lines, RPC payloads) with one table into a single batch
+ *
+ * Encoding every message as a block of its own costs a histogram, a table and a header per message,
+ * often more than the message itself. The batch encoder counts the symbols of all messages at once,
+ * builds one table (or uses the model set with setModel() if it has a code for every byte of the
+ * messages) and writes the messages behind each other.
+ * Every message starts at a byte boundary and its position is stored in an offsets array, so a
+ * single message can be decoded without the ones before it.
+ *
+ * Layout: flags (8 bits, SFBlockHeader::NEW_TABLE or SFBlockHeader::EXTERNAL_TABLE, 0 if all messages
+ * are empty), number of messages (32 bits), the table if NEW_TABLE is set, then at the next byte boundary
+ * the decoded size of every message (32 bits each), the end of the codes of every message relative
+ * to the first code byte (32 bits each) and the codes.
+ */
+class SFBatchEncoder
+{
+public:
+    SFBatchEncoder();
+
+    void setModel(const SFCodeTable& p_model) {m_model = p_model;}
+    void setBuilder(const SFCodeBuilder& p_builder) {m_builder = &p_builder;}
+
+    QByteArray encode(const QVector<QByteArray>& p_messages) const;
+    void encode(const char* p_data, const quint32* p_offsets, int p_count, QByteArray& p_out) const;
+
+private:
+    SFCodeTable m_model;
+    const SFCodeBuilder* m_builder;
+};
+
+/**
+ * \class SFBatchDecoder
+ * @brief Decodes a batch written by SFBatchEncoder
+ *
+ * open() reads the table and checks the offsets array, the messages are then decoded one by one
+ * with decodeMessage() or all at once with decodeAll(). decodeAll() decodes LANES messages side
+ * by side (one symbol of every message per iteration) so the lookups do not wait for each other,
+ * like the streams of a block (see SFBlockEncoder::setStreams()).
+ *
+ * The decoder does not copy the batch, it has to stay valid while the decoder is used.
+ */
+class SFBatchDecoder
+{
+public:
+    enum {LANES = 4};
+
+    SFBatchDecoder();
+
+    void setModel(const SFCodeTable& p_model) {m_model = p_model;}
+
+    bool open(const char* p_batch, qint64 p_size);
+    int count() const {return m_count;}
+    quint32 messageSize(int p_index) const {return quint32(m_offsets.at(p_index + 1) - m_offsets.at(p_index));}
+    qint64 messageOffset(int p_index) const {return m_offsets.at(p_index);}   //position of the message in the output of decodeAll()
+    qint64 decodedSize() const {return m_offsets.last();}
+
+    bool decodeMessage(int p_index, char* p_out) const;
+    bool decodeAll(char* p_out) const;
+
+    bool decode(const QByteArray& p_batch, QVector<QByteArray>& p_messages);
+
+private:
+    SFBitReader codes(int p_index) const;
+
+    SFCodeTable m_model;
+    SFCodeTable m_table;
+    int m_count;
+    const uchar* m_ends;        //end of the codes of every message (32 bits, big endian)
+    const char* m_codes;
+    QVector<qint64> m_offsets;  //m_count + 1 positions of the decoded messages
+};
+
+#endif // SFBATCHCODEC_H
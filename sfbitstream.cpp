@@ -0,0 +1,159 @@
+#include "sfbitstream.h"
+
+SFBitWriter::SFBitWriter(QByteArray* p_out):
+    m_out(p_out),
+    m_start(p_out->size()),
+    m_data(0),
+    m_capacity(0),
+    m_size(0),
+    m_overflow(false),
+    m_buffer(0),
+    m_fill(0),
+    m_bit_count(0)
+{
+
+}
+
+/**
+ * @brief SFBitWriter::SFBitWriter writes into a caller owned buffer
+ * @param p_out the buffer
+ * @param p_capacity size of the buffer. Nothing is written behind it
+ */
+SFBitWriter::SFBitWriter(char* p_out, qint64 p_capacity):
+    m_out(0),
+    m_start(0),
+    m_data(p_out),
+    m_capacity(p_capacity),
+    m_size(0),
+    m_overflow(false),
+    m_buffer(0),
+    m_fill(0),
+    m_bit_count(0)
+{
+
+}
+
+/**
+ * @brief SFBitWriter::put writes one complete byte
+ */
+inline void SFBitWriter::put(char p_byte)
+{
+    if(m_out)
+        m_out->append(p_byte);
+    else if(m_size < m_capacity)
+        m_data[m_size] = p_byte;
+    else
+        m_overflow = true;
+    m_size++;
+}
+
+/**
+ * @brief SFBitWriter::writeBits appends the p_length lowest bits of p_bits to the output
+ * @param p_bits the code right aligned
+ * @param p_length number of bits to write (0-64)
+ */
+void SFBitWriter::writeBits(quint64 p_bits, int p_length)
+{
+    Q_ASSERT(p_length >= 0 && p_length <= 64);
+
+    if(p_length > 32)                               //m_buffer can hold 7 pending bits plus 32 new ones
+    {                                               //so longer codes are written in two parts
+        writeBits(p_bits >> 32, p_length - 32);
+        p_length = 32;
+    }
+    if(p_length < 64)
+        p_bits &= (quint64(1) << p_length) - 1;
+
+    m_buffer = (m_buffer << p_length) | p_bits;
+    m_fill += p_length;
+    m_bit_count += p_length;
+
+    while(m_fill >= 8)
+    {
+        m_fill -= 8;
+        put(char(m_buffer >> m_fill));
+    }
+    m_buffer &= (quint64(1) << m_fill) - 1;
+}
+
+/**
+ * @brief SFBitWriter::flush writes the pending bits padding the last byte with zeros
+ */
+void SFBitWriter::flush()
+{
+    if(m_fill > 0)
+    {
+        put(char(m_buffer << (8 - m_fill)));
+        m_bit_count += 8 - m_fill;
+        m_buffer = 0;
+        m_fill = 0;
+    }
+}
+
+/**
+ * @brief SFBitWriter::reserve skips p_bytes so they can be filled in later
+ * @param p_bytes number of bytes. The writer has to be at a byte boundary
+ * @return pointer to the reserved bytes or 0 if the buffer is too small. The pointer is only
+ * valid until the next write if the writer appends to a QByteArray
+ */
+char* SFBitWriter::reserve(qint64 p_bytes)
+{
+    Q_ASSERT(m_fill == 0);
+
+    qint64 pos = m_size;
+    m_size += p_bytes;
+    m_bit_count += 8*p_bytes;
+    if(m_out)
+    {
+        m_out->resize(int(m_start + m_size));
+        return m_out->data() + m_start + pos;
+    }
+    if(m_size > m_capacity)
+    {
+        m_overflow = true;
+        return 0;
+    }
+    return m_data + pos;
+}
+
+
+SFBitReader::SFBitReader(const char* p_data, qint64 p_size):
+    m_data(reinterpret_cast<const uchar*>(p_data)),
+    m_size(p_size),
+    m_pos(0)
+{
+
+}
+
+SFBitReader::SFBitReader(const QByteArray& p_data):
+    SFBitReader(p_data.constData(), p_data.size())
+{
+
+}
+
+/**
+ * @brief SFBitReader::readBit reads the next bit
+ * @return 0 or 1 or -1 if the end of the buffer was reached
+ */
+int SFBitReader::readBit()
+{
+    if(atEnd())
+        return -1;
+
+    int bit = (m_data[m_pos >> 3] >> (7 - (m_pos & 7))) & 1;
+    m_pos++;
+    return bit;
+}
+
+/**
+ * @brief SFBitReader::readBits reads the next p_length bits
+ * @param p_length number of bits to read (0-64)
+ * @return the bits right aligned
+ */
+quint64 SFBitReader::readBits(int p_length)
+{
+    quint64 result = 0;
+    for(int i = 0; i < p_length; i++)
+        result = (result << 1) | quint64(readBit() > 0);
+    return result;
+}
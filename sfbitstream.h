@@ -0,0 +1,107 @@
+#ifndef SFBITSTREAM_H
+#define SFBITSTREAM_H
+
+#include <QByteArray>
+#include <QtEndian>
+#include <QtGlobal>
+
+/**
+ * \class SFBitWriter
+ * @brief Packs variable length codes into bytes (most significant bit first)
+ *
+ * The writer either appends every completed byte to the QByteArray it was constructed with
+ * or writes into a caller owned buffer of fixed capacity. If such a buffer is too small the
+ * remaining bytes are dropped and overflow() returns true.
+ * Call flush() once all codes are written to pad the last byte with zeros.
+ */
+class SFBitWriter
+{
+public:
+    explicit SFBitWriter(QByteArray* p_out);
+    SFBitWriter(char* p_out, qint64 p_capacity);
+
+    void writeBits(quint64 p_bits, int p_length);   //writes the p_length lowest bits of p_bits
+    void flush();                                   //pads the current byte with zeros
+    char* reserve(qint64 p_bytes);                  //skips p_bytes (byte aligned) and returns a pointer to them
+
+    qint64 bitCount() const {return m_bit_count;}
+    qint64 byteCount() const {return m_size;}       //number of complete bytes written
+    char* data() {return m_out ? m_out->data() + m_start : m_data;}     //first byte written by this writer
+    bool overflow() const {return m_overflow;}
+
+private:
+    inline void put(char p_byte);
+
+    QByteArray* m_out;
+    qint64 m_start;         //size of m_out when the writer was constructed
+    char* m_data;           //caller owned buffer (if m_out is 0)
+    qint64 m_capacity;
+    qint64 m_size;
+    bool m_overflow;
+    quint64 m_buffer;       //bits not yet written (right aligned)
+    int m_fill;             //number of valid bits in m_buffer
+    qint64 m_bit_count;
+};
+
+/**
+ * \class SFBitReader
+ * @brief Reads single bits (most significant bit first) from a contiguous buffer
+ *
+ * The reader does not copy or own the buffer. It has to stay valid as long as the reader is used.
+ * peekBits() and skipBits() are inline so table driven decoders (see SFCodeTable::decode()) can
+ * look at several bits at once without a function call per bit.
+ */
+class SFBitReader
+{
+public:
+    SFBitReader(const char* p_data, qint64 p_size);
+    explicit SFBitReader(const QByteArray& p_data);
+
+    int readBit();                  //returns -1 at the end of the buffer
+    quint64 readBits(int p_length); //returns 0 for bits behind the end of the buffer
+    inline quint64 peekBits(int p_length) const;
+    void skipBits(int p_length) {m_pos += p_length;}
+
+    void alignToByte() {m_pos = (m_pos + 7) & ~qint64(7);}
+    void skipBytes(qint64 p_bytes) {alignToByte(); m_pos += p_bytes*8;}
+
+    bool atEnd() const {return m_pos >= m_size*8;}
+    qint64 bitsLeft() const {return m_size*8 - m_pos;}
+    qint64 bitPos() const {return m_pos;}
+    qint64 bytePos() const {return (m_pos + 7)/8;}
+    const char* data() const {return reinterpret_cast<const char*>(m_data);}
+    qint64 size() const {return m_size;}
+
+private:
+    const uchar* m_data;
+    qint64 m_size;
+    qint64 m_pos;           //position in bits
+};
+
+/**
+ * @brief SFBitReader::peekBits returns the next p_length bits without moving the position
+ * @param p_length number of bits (1-57)
+ * @return the bits right aligned. Bits behind the end of the buffer are 0
+ *
+ * Loads the 8 bytes containing the position at once (byte by byte only near the end of the buffer).
+ */
+inline quint64 SFBitReader::peekBits(int p_length) const
+{
+    Q_ASSERT(p_length > 0 && p_length <= 57);
+
+    qint64 byte = m_pos >> 3;
+    quint64 window;
+    if(byte + 8 <= m_size)
+    {
+        window = qFromBigEndian<quint64>(m_data + byte);
+    }
+    else
+    {
+        window = 0;
+        for(qint64 i = byte; i < byte + 8; i++)
+            window = (window << 8) | (i < m_size ? m_data[i] : 0);
+    }
+    return (window << (m_pos & 7)) >> (64 - p_length);
+}
+
+#endif // SFBITSTREAM_H
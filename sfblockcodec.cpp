@@ -0,0 +1,672 @@
+#include "sfblockcodec.h"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+/**
+ * @brief SFBlockHeader::write writes the header (SFBlockHeader::BITS bits)
+ */
+void SFBlockHeader::write(SFBitWriter& p_writer) const
+{
+    p_writer.writeBits(flags, 8);
+    p_writer.writeBits(table_slot, 8);
+    p_writer.writeBits(size, 32);
+    p_writer.writeBits(body_size, 32);
+}
+
+/**
+ * @brief SFBlockHeader::read reads a header written by SFBlockHeader::write()
+ * @return false if there are not enough bytes left for a header or the block is larger than MAX_SIZE
+ */
+bool SFBlockHeader::read(SFBitReader& p_reader)
+{
+    if(p_reader.size()*8 - p_reader.bitPos() < BITS)
+        return false;
+
+    flags = quint8(p_reader.readBits(8));
+    table_slot = quint8(p_reader.readBits(8));
+    size = quint32(p_reader.readBits(32));
+    body_size = quint32(p_reader.readBits(32));
+    return size <= quint32(MAX_SIZE);
+}
+
+
+SFBlockEncoder::SFBlockEncoder(int p_block_size, int p_cache_size):
+    m_cache(p_cache_size),
+    m_slot_position(p_cache_size, -1),
+    m_model(0),
+    m_builder(&SFCodeBuilder::shannonFano()),
+    m_next_slot(0),
+    m_block_size(qBound(1, p_block_size, int(SFBlockHeader::MAX_SIZE))),
+    m_context_buckets(0),
+    m_streams(1),
+    m_built_tables(0),
+    m_reused_tables(0),
+    m_stored_blocks(0),
+    m_position(0)
+{
+    Q_ASSERT(p_cache_size > 0 && p_cache_size <= 256);
+}
+
+/**
+ * @brief SFBlockEncoder::encode splits p_input into blocks and encodes them
+ * @param p_input the data to encode
+ * @return the encoded blocks
+ */
+QByteArray SFBlockEncoder::encode(const QByteArray& p_input)
+{
+    QByteArray result;
+    for(int pos = 0; pos < p_input.size(); pos += m_block_size)
+        encodeBlock(p_input.constData() + pos, qMin(m_block_size, p_input.size() - pos), result);
+    return result;
+}
+
+/**
+ * @brief SFBlockEncoder::encodeBlock encodes a single block and appends it to p_out
+ * @param p_data pointer to the first byte of the block
+ * @param p_size size of the block
+ * @param p_out the encoded block is appended to this array
+ */
+void SFBlockEncoder::encodeBlock(const char* p_data, int p_size, QByteArray& p_out)
+{
+    SFBitWriter writer(&p_out);
+    writeBlock(p_data, p_size, writer);
+}
+
+/**
+ * @brief SFBlockEncoder::encodeBlock encodes a single block into a caller owned buffer
+ * @param p_data pointer to the first byte of the block
+ * @param p_size size of the block
+ * @param p_out the encoded block is written to this buffer
+ * @param p_capacity size of p_out
+ * @return size of the encoded block or -1 if p_out is too small. In that case the encoder
+ * is left in the state it had before the call, so the block can be encoded again.
+ */
+qint64 SFBlockEncoder::encodeBlock(const char* p_data, int p_size, char* p_out, qint64 p_capacity)
+{
+    QVector<SFCodeTable> cache = m_cache;       //tables are implicitly shared so this is cheap
+    int next_slot = m_next_slot, built_tables = m_built_tables, reused_tables = m_reused_tables, stored_blocks = m_stored_blocks;
+
+    SFBitWriter writer(p_out, p_capacity);
+    writeBlock(p_data, p_size, writer);
+    if(!writer.overflow())
+        return writer.byteCount();
+
+    m_cache = cache;
+    m_next_slot = next_slot;
+    m_built_tables = built_tables;
+    m_reused_tables = reused_tables;
+    m_stored_blocks = stored_blocks;
+    return -1;
+}
+
+/**
+ * @brief SFBlockEncoder::writeBlock encodes a block with all steps and writes it to p_writer
+ */
+void SFBlockEncoder::writeBlock(const char* p_data, int p_size, SFBitWriter& p_writer)
+{
+    Q_ASSERT(p_size <= SFBlockHeader::MAX_SIZE);
+    Block block;
+    block.data = p_data;
+    block.size = p_size;
+
+    analyze(block);
+    select(block);
+    write(block, p_writer);
+    if(!p_writer.overflow())
+        commit(block);
+}
+
+/**
+ * @brief SFBlockEncoder::analyze counts the symbols of a block and builds its order-1 tables
+ * @param p_block block whose data and size are set
+ * @param p_build_table also build the table for the histogram, even if select() might reuse a cached one
+ *
+ * If the entropy of the histogram is not below 8 bits per byte no order-0 table (not even a model)
+ * can make the block smaller. Unless the order-1 tables do, the block is marked as stored and no
+ * table is built. Does not change the encoder.
+ */
+void SFBlockEncoder::analyze(Block& p_block, bool p_build_table) const
+{
+    p_block.histogram = SFCodeTable::histogram(p_block.data, p_block.size);
+    double entropy = SFCodeTable::entropyBound(p_block.histogram);
+    double raw_bits = 8.0*p_block.size;
+
+    if(m_model.isEmpty() && m_context_buckets > 0)
+    {
+        SFContextTable context = SFContextTable::fromData(p_block.data, p_block.size, m_context_buckets, *m_builder);
+        if(context.buckets() > 0                                                //order-1 tables are only used if they
+           && context.cost(p_block.data, p_block.size) + context.serializedBits()   //beat every possible order-0 table
+              < qMin(entropy, raw_bits))                                        //and storing the block
+            p_block.context = context;
+    }
+    if(entropy >= raw_bits && p_block.context.buckets() == 0)
+    {
+        p_block.stored = true;
+        return;
+    }
+    if(p_build_table && m_model.isEmpty() && p_block.context.buckets() == 0)
+        p_block.new_table = SFCodeTable::fromHistogram(p_block.histogram, *m_builder);
+}
+
+/**
+ * @brief SFBlockEncoder::select picks the table of an analyzed block and sets its header
+ *
+ * Blocks whose codes would not be smaller than the block are stored instead. Has to be called
+ * for the blocks in the order they are written because it updates the table cache.
+ */
+void SFBlockEncoder::select(Block& p_block)
+{
+    SFBlockHeader& header = p_block.header;
+    header.flags = 0;
+    header.table_slot = 0;
+    header.size = quint32(p_block.size);
+    header.body_size = 0;
+
+    quint64 limit = codeBitsLimit(p_block.size);
+    if(p_block.stored || (!m_model.isEmpty() && m_model.cost(p_block.histogram) >= limit))
+    {
+        header.flags = SFBlockHeader::STORED;
+        m_stored_blocks++;
+        return;
+    }
+
+    if(!m_model.isEmpty())
+    {
+        header.flags = SFBlockHeader::EXTERNAL_TABLE;
+        p_block.table = m_model;
+    }
+    else if(p_block.context.buckets() > 0)
+    {
+        header.flags = SFBlockHeader::CONTEXT_TABLES;
+    }
+    else
+    {
+        bool new_table = false;
+        int slot = selectTable(p_block.histogram, p_block.new_table, limit, new_table);
+        if(slot < 0)
+        {
+            header.flags = SFBlockHeader::STORED;
+            m_stored_blocks++;
+            return;
+        }
+        header.flags = new_table ? SFBlockHeader::NEW_TABLE : 0;
+        header.table_slot = quint8(slot);
+        p_block.table = m_cache.at(slot);
+    }
+    if(!p_block.table.isEmpty() && m_streams > 1)
+        header.flags |= SFBlockHeader::MULTI_STREAM;
+}
+
+/**
+ * @brief SFBlockEncoder::write writes the header, the tables and the codes of a selected block
+ *
+ * The header is written last into the bytes reserved for it, once the size of the block is known.
+ * Nothing is encoded into temporary buffers. Does not change the encoder.
+ */
+void SFBlockEncoder::write(Block& p_block, SFBitWriter& p_writer) const
+{
+    SFBlockHeader& header = p_block.header;
+    qint64 header_pos = p_writer.byteCount();
+    p_writer.reserve(SFBlockHeader::BYTES);
+
+    if(header.flags & SFBlockHeader::STORED)
+    {
+        char* body = p_writer.reserve(p_block.size);
+        if(body)
+            std::memcpy(body, p_block.data, size_t(p_block.size));
+    }
+    else if(header.flags & SFBlockHeader::CONTEXT_TABLES)
+    {
+        p_block.context.write(p_writer);
+        p_writer.flush();
+        p_block.context.encode(p_writer, p_block.data, p_block.size);
+    }
+    else
+    {
+        if(header.flags & SFBlockHeader::NEW_TABLE)
+            p_block.table.write(p_writer);
+        p_writer.flush();
+
+        if(header.flags & SFBlockHeader::MULTI_STREAM)
+        {
+            encodeStreams(p_block.table, p_block.data, p_block.size, p_writer);
+        }
+        else
+        {
+            for(int i = 0; i < p_block.size; i++)
+                p_block.table.encode(p_writer, uchar(p_block.data[i]));
+        }
+    }
+    p_writer.flush();
+
+    header.body_size = quint32(p_writer.byteCount() - header_pos - SFBlockHeader::BYTES);
+    if(!p_writer.overflow())
+    {
+        SFBitWriter header_writer(p_writer.data() + header_pos, SFBlockHeader::BYTES);
+        header.write(header_writer);
+    }
+}
+
+/**
+ * @brief SFBlockEncoder::commit adds a written block to index()
+ *
+ * Has to be called for the blocks in the order they are written.
+ */
+void SFBlockEncoder::commit(const Block& p_block)
+{
+    const SFBlockHeader& header = p_block.header;
+    SFBlockIndex::Entry entry = {m_index.decodedSize(), m_position, -1};
+    if(header.usesCache())
+    {
+        if(header.flags & SFBlockHeader::NEW_TABLE)
+            m_slot_position[header.table_slot] = m_position;
+        entry.table_position = m_slot_position.at(header.table_slot);
+    }
+
+    m_index.append(entry, header.size);
+    m_position += SFBlockHeader::BYTES + header.body_size;
+}
+
+/**
+ * @brief SFBlockEncoder::encodeStreams encodes a block into m_streams interleaved streams
+ * @param p_writer the stream count, the stream sizes and the streams are written to this writer (at a byte boundary)
+ *
+ * The size of every stream is calculated from the code lengths first, so every stream can be
+ * written directly to its place in the output.
+ */
+void SFBlockEncoder::encodeStreams(const SFCodeTable& p_table, const char* p_data, int p_size, SFBitWriter& p_writer) const
+{
+    Q_ASSERT(m_streams > 1 && m_streams <= MAX_STREAMS);
+
+    std::vector<qint64> sizes(m_streams, 0);
+    for(int i = 0; i < p_size; i++)
+        sizes[i % m_streams] += p_table.code(uchar(p_data[i])).length;
+
+    qint64 total = 0;
+    p_writer.writeBits(m_streams, 8);
+    for(int s = 0; s < m_streams; s++)
+    {
+        sizes[s] = (sizes[s] + 7)/8;
+        total += sizes[s];
+        if(s < m_streams - 1)
+            p_writer.writeBits(sizes[s], 32);
+    }
+
+    char* streams = p_writer.reserve(total);
+    if(!streams)
+        return;
+
+    std::vector<SFBitWriter> writers;
+    for(int s = 0; s < m_streams; s++)
+    {
+        writers.push_back(SFBitWriter(streams, sizes[s]));
+        streams += sizes[s];
+    }
+    for(int i = 0; i < p_size; i++)
+        p_table.encode(writers[i % m_streams], uchar(p_data[i]));
+    for(SFBitWriter& writer:writers)
+        writer.flush();
+}
+
+/**
+ * @brief SFBlockEncoder::selectTable finds the cheapest table for a block
+ * @param p_histogram histogram of the block
+ * @param p_new_table the table built for p_histogram or an empty table if it was not built yet
+ * @param p_limit the codes (and a new table) have to take less bits than this (see codeBitsLimit())
+ * @param p_new is set to true if the new table was stored in the cache and has to be written into the block
+ * @return slot of the selected table in m_cache or -1 if no table stays below p_limit. The cache
+ * is not changed then
+ */
+int SFBlockEncoder::selectTable(const QVector<quint64>& p_histogram, const SFCodeTable& p_new_table, quint64 p_limit, bool& p_new)
+{
+    int symbols = 0;
+    for(quint64 count:p_histogram)
+        symbols += (count > 0);
+
+    int best_slot = -1;
+    quint64 best_cost = SFCodeTable::NO_CODE;
+    for(int slot = 0; slot < m_cache.size(); slot++)
+    {
+        quint64 cost = m_cache.at(slot).cost(p_histogram);
+        if(!m_cache.at(slot).isEmpty() && cost < best_cost)
+        {
+            best_cost = cost;
+            best_slot = slot;
+        }
+    }
+
+    double table_bits = SFCodeTable::serializedBits(symbols, 256);
+    if(best_slot >= 0 && best_cost <= SFCodeTable::entropyBound(p_histogram) + table_bits)
+    {                                           //a new table can not beat this one
+        if(best_cost >= p_limit)                //so there is no need to build it
+            return -1;
+        m_reused_tables++;
+        p_new = false;
+        return best_slot;
+    }
+
+    SFCodeTable table = p_new_table.isEmpty() ? SFCodeTable::fromHistogram(p_histogram, *m_builder) : p_new_table;
+    quint64 new_cost = table.isEmpty() ? SFCodeTable::NO_CODE               //no table could be built
+                                       : table.cost(p_histogram) + quint64(table.serializedBits());
+    if(best_slot >= 0 && best_cost <= new_cost)
+    {
+        if(best_cost >= p_limit)
+            return -1;
+        m_reused_tables++;
+        p_new = false;
+        return best_slot;
+    }
+    if(new_cost >= p_limit)
+        return -1;
+
+    int slot = m_next_slot;
+    m_next_slot = (m_next_slot + 1) % m_cache.size();
+    m_cache[slot] = table;
+    m_built_tables++;
+    p_new = true;
+    return slot;
+}
+
+/**
+ * @brief SFBlockEncoder::codeBitsLimit returns how many bits the codes of a block may take at most
+ * @param p_size size of the block
+ * @return 8*p_size minus the stream sizes and the padding, a block whose codes (and new table)
+ * take this many bits or more is stored
+ */
+quint64 SFBlockEncoder::codeBitsLimit(int p_size) const
+{
+    qint64 overhead = 2*8;                      //padding behind the table and behind the codes
+    if(m_streams > 1)
+        overhead += 8 + 32*(m_streams - 1) + 8*m_streams;
+    return quint64(qMax(8*qint64(p_size) - overhead, qint64(0)));
+}
+
+SFBlockDecoder::SFBlockDecoder(int p_cache_size):
+    m_cache(p_cache_size),
+    m_slot_position(p_cache_size, -1),
+    m_model(0)
+{
+
+}
+
+/**
+ * @brief SFBlockDecoder::decode decodes all blocks in p_input
+ * @param p_input the output of SFBlockEncoder::encode()
+ * @return the decoded data (up to the first corrupted block)
+ */
+QByteArray SFBlockDecoder::decode(const QByteArray& p_input)
+{
+    QByteArray result;
+    SFBitReader reader(p_input);
+
+    while(!reader.atEnd() && decodeBlock(reader, result))
+    {
+    }
+    return result;
+}
+
+/**
+ * @brief SFBlockDecoder::decode decodes all blocks in p_input into a caller owned buffer
+ * @param p_out the buffer (see SFBlockDecoder::decodedSize())
+ * @param p_capacity size of p_out
+ * @return size of the decoded data or -1 if the input is corrupted or p_out is too small
+ */
+qint64 SFBlockDecoder::decode(const char* p_input, qint64 p_size, char* p_out, qint64 p_capacity)
+{
+    SFBitReader reader(p_input, p_size);
+    qint64 size = 0;
+    while(!reader.atEnd())
+    {
+        qint64 block = decodeBlock(reader, p_out + size, p_capacity - size);
+        if(block < 0)
+            return -1;
+        size += block;
+    }
+    return size;
+}
+
+/**
+ * @brief SFBlockDecoder::decodeRange decodes a range of the decoded data without decoding the blocks in front of it
+ * @param p_blocks the output of SFBlockEncoder
+ * @param p_size size of the blocks (without the index)
+ * @param p_index index of the blocks (see SFBlockEncoder::index(), SFBlockIndex::read() and SFBlockIndex::build())
+ * @param p_offset first byte of the range in the decoded data
+ * @param p_length size of the range
+ * @param p_out buffer for p_length bytes
+ * @return p_length or -1 if the range is behind the end of the data or a block is corrupted
+ *
+ * Only the blocks overlapping the range are decoded, blocks in the middle of the range directly
+ * into p_out. If a block reuses a table, only the table is read from the block that wrote it.
+ */
+qint64 SFBlockDecoder::decodeRange(const char* p_blocks, qint64 p_size, const SFBlockIndex& p_index,
+                                   qint64 p_offset, qint64 p_length, char* p_out)
+{
+    if(p_offset < 0 || p_length < 0 || p_offset + p_length > p_index.decodedSize())
+        return -1;
+
+    QByteArray buffer;
+    qint64 done = 0;
+    for(int block = p_index.find(p_offset); done < p_length; block++)
+    {
+        const SFBlockIndex::Entry& entry = p_index.at(block);
+        qint64 block_size = p_index.blockSize(block);
+        if(entry.position >= p_size || block_size > SFBlockHeader::MAX_SIZE
+           || (entry.table_position >= 0 && entry.table_position != entry.position && !loadTable(p_blocks, p_size, entry.table_position)))
+            return -1;
+
+        qint64 skip = p_offset + done - entry.offset;   //only the first block is entered behind its start
+        qint64 count = qMin(block_size - skip, p_length - done);
+        char* out = p_out + done;
+        if(skip > 0 || count < block_size)              //block is only partly inside the range
+        {
+            buffer.resize(int(block_size));
+            out = buffer.data();
+        }
+
+        SFBitReader reader(p_blocks + entry.position, p_size - entry.position);
+        SFBlockHeader header;
+        SFBitReader peek = reader;
+        if(!header.read(peek) || header.size != block_size || header.table_slot >= m_cache.size()
+           || (entry.table_position >= 0 && entry.table_position != entry.position
+               && m_slot_position.at(header.table_slot) != entry.table_position)
+           || decodeBlock(reader, out, block_size) != block_size)
+            return -1;
+        if(entry.table_position == entry.position)
+            m_slot_position[header.table_slot] = entry.position;
+
+        if(out == buffer.data())
+            std::memcpy(p_out + done, out + skip, size_t(count));
+        done += count;
+    }
+    return p_length;
+}
+
+/**
+ * @brief SFBlockDecoder::loadTable reads the table written by the block at p_position into its slot
+ * @return false if the block does not contain a table or is corrupted
+ *
+ * Nothing is read if the slot already holds that table.
+ */
+bool SFBlockDecoder::loadTable(const char* p_blocks, qint64 p_size, qint64 p_position)
+{
+    SFBitReader reader(p_blocks + p_position, p_size - p_position);
+    SFBlockHeader header;
+    if(!header.read(reader) || !(header.flags & SFBlockHeader::NEW_TABLE) || header.table_slot >= m_cache.size()
+       || reader.bytePos() + header.body_size > reader.size())
+        return false;
+    if(m_slot_position.at(header.table_slot) == p_position)
+        return true;
+
+    SFBitReader body(reader.data() + reader.bytePos(), header.body_size);
+    SFCodeTable table = SFCodeTable::read(body);
+    if(table.isEmpty())
+        return false;
+
+    m_cache[header.table_slot] = table;
+    m_slot_position[header.table_slot] = p_position;
+    return true;
+}
+
+/**
+ * @brief SFBlockDecoder::decodedSize calculates the size of the decoded data from the block headers
+ * @param p_input the output of SFBlockEncoder
+ * @return the size or -1 if a block is cut off
+ *
+ * Only the headers are read, the tables and codes of every block are skipped.
+ */
+qint64 SFBlockDecoder::decodedSize(const char* p_input, qint64 p_size)
+{
+    SFBitReader reader(p_input, p_size);
+    qint64 size = 0;
+    while(!reader.atEnd())
+    {
+        SFBlockHeader header;
+        if(!header.read(reader) || reader.bytePos() + header.body_size > p_size)
+            return -1;
+        reader.skipBytes(header.body_size);
+        size += header.size;
+    }
+    return size;
+}
+
+/**
+ * @brief SFBlockDecoder::decodeBlock decodes the block at the position of p_reader
+ * @param p_reader SFBitReader positioned at the start of a block. It is moved behind the block
+ * @param p_out the decoded block is appended to this array
+ * @return false if the block is corrupted
+ */
+bool SFBlockDecoder::decodeBlock(SFBitReader& p_reader, QByteArray& p_out)
+{
+    SFBitReader peek = p_reader;
+    SFBlockHeader header;
+    if(!header.read(peek) || peek.bytePos() + header.body_size > peek.size())
+        return false;
+
+    int start = p_out.size();
+    if(header.size > quint32(std::numeric_limits<int>::max() - start))
+        return false;
+    p_out.resize(start + int(header.size));
+    if(decodeBlock(p_reader, p_out.data() + start, p_out.size() - start) < 0)
+    {
+        p_out.resize(start);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief SFBlockDecoder::decodeBlock decodes the block at the position of p_reader into a caller owned buffer
+ * @param p_reader SFBitReader positioned at the start of a block. It is moved behind the block
+ * @param p_out the decoded block is written to this buffer
+ * @param p_capacity size of p_out
+ * @return size of the decoded block or -1 if the block is corrupted or p_out is too small
+ */
+qint64 SFBlockDecoder::decodeBlock(SFBitReader& p_reader, char* p_out, qint64 p_capacity)
+{
+    SFBlockHeader header;
+    if(!header.read(p_reader) || header.table_slot >= m_cache.size() || header.size > p_capacity
+       || p_reader.bytePos() + header.body_size > p_reader.size())
+        return -1;
+
+    SFBitReader body(p_reader.data() + p_reader.bytePos(), header.body_size);
+    p_reader.skipBytes(header.body_size);
+
+    if(header.flags & SFBlockHeader::STORED)
+    {
+        if(header.body_size != header.size)
+            return -1;
+        std::memcpy(p_out, body.data(), header.size);
+        return header.size;
+    }
+
+    SFContextTable context;
+    if(header.flags & SFBlockHeader::CONTEXT_TABLES)
+        context = SFContextTable::read(body);
+    else if(header.flags & SFBlockHeader::NEW_TABLE)
+    {
+        m_cache[header.table_slot] = SFCodeTable::read(body);
+        m_slot_position[header.table_slot] = -1;     //see decodeRange()
+    }
+    body.alignToByte();
+    if(body.bytePos() > body.size())
+        return -1;
+
+    const SFCodeTable& table = (header.flags & SFBlockHeader::EXTERNAL_TABLE) ? m_model : m_cache.at(header.table_slot);
+    SFBitReader codes(body.data() + body.bytePos(), body.size() - body.bytePos());
+
+    if(header.flags & SFBlockHeader::CONTEXT_TABLES)
+    {
+        if(context.buckets() == 0 || !context.decode(codes, p_out, int(header.size)))
+            return -1;
+        return header.size;
+    }
+
+    if(table.isEmpty())
+        return -1;
+
+    if(header.flags & SFBlockHeader::MULTI_STREAM)
+        return decodeStreams(table, codes.data(), codes.size(), p_out, header.size) ? header.size : -1;
+
+    for(quint32 i = 0; i < header.size; i++)
+    {
+        int sym = table.decode(codes);
+        if(sym < 0)
+            return -1;
+        p_out[i] = char(sym);
+    }
+    return header.size;
+}
+
+/**
+ * @brief SFBlockDecoder::decodeStreams decodes a payload written by SFBlockEncoder::encodeStreams()
+ * @param p_payload pointer to the payload (starting with the number of streams)
+ * @param p_out buffer for p_size symbols
+ * @return false if the payload is corrupted
+ *
+ * The main loop decodes one symbol of every stream per iteration. The streams have separate
+ * readers so the lookups do not depend on each other.
+ */
+bool SFBlockDecoder::decodeStreams(const SFCodeTable& p_table, const char* p_payload, quint32 p_payload_size,
+                                   char* p_out, quint32 p_size)
+{
+    SFBitReader header(p_payload, p_payload_size);
+    int count = int(header.readBits(8));
+    qint64 offset = 1 + 4*qint64(count - 1);
+    if(count < 2 || count > SFBlockEncoder::MAX_STREAMS || offset > p_payload_size)
+        return false;
+
+    std::vector<SFBitReader> readers;
+    for(int s = 0; s < count; s++)
+    {
+        qint64 size = (s < count - 1) ? qint64(header.readBits(32)) : p_payload_size - offset;
+        if(size < 0 || offset + size > p_payload_size)
+            return false;
+        readers.push_back(SFBitReader(p_payload + offset, size));
+        offset += size;
+    }
+
+    quint32 i = 0;
+    quint32 rounds_end = p_size - p_size % quint32(count);
+    bool ok = true;
+    while(i < rounds_end)
+    {
+        for(int s = 0; s < count; s++)
+        {
+            int sym = p_table.decode(readers[s]);
+            ok &= (sym >= 0);
+            p_out[i++] = char(sym);
+        }
+        if(!ok)
+            return false;
+    }
+    for(int s = 0; i < p_size; s++)
+    {
+        int sym = p_table.decode(readers[s]);
+        if(sym < 0)
+            return false;
+        p_out[i++] = char(sym);
+    }
+    return true;
+}
@@ -0,0 +1,179 @@
+#ifndef SFBLOCKCODEC_H
+#define SFBLOCKCODEC_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "sfcodetable.h"
+#include "sfcontexttable.h"
+#include "sfbitstream.h"
+#include "sfblockindex.h"
+
+/**
+ * @brief The SFBlockHeader struct precedes every block written by SFBlockEncoder
+ *
+ * Layout (80 bits): flags (8), table slot (8), number of symbols (32), body size in bytes (32).
+ * The body (everything behind the header) can be skipped without reading it, so the decoded size
+ * of a stream of blocks is known from the headers alone (see SFBlockDecoder::decodedSize()).
+ * If the NEW_TABLE flag is set a serialized SFCodeTable follows which is stored in the cache
+ * at table_slot. If the EXTERNAL_TABLE flag is set the block was encoded with a pretrained
+ * model (see SFModel) the decoder has to be given. Otherwise the block uses the table already
+ * cached at table_slot. If the CONTEXT_TABLES flag is set the block was encoded with order-1
+ * tables (see SFContextTable) which follow the header. The codes start at the next byte boundary.
+ * If the MULTI_STREAM flag is set the codes is split into interleaved streams (see SFBlockEncoder::setStreams()).
+ * If the STORED flag is set the body is the block itself, copied without encoding.
+ * Blocks hold at most MAX_SIZE symbols, read() rejects headers of larger blocks.
+ */
+struct SFBlockHeader
+{
+    enum Flags {NEW_TABLE = 0x01, EXTERNAL_TABLE = 0x02, CONTEXT_TABLES = 0x04, MULTI_STREAM = 0x08, STORED = 0x10};
+    static const int BITS = 80;
+    static const int BYTES = BITS/8;
+    static const int MAX_SIZE = 1 << 28;
+
+    quint8 flags;
+    quint8 table_slot;
+    quint32 size;
+    quint32 body_size;          //tables and codes
+
+    void write(SFBitWriter& p_writer) const;
+    bool read(SFBitReader& p_reader);
+    bool usesCache() const {return !(flags & (EXTERNAL_TABLE | CONTEXT_TABLES | STORED));}  //the block uses the table at table_slot
+};
+
+/**
+ * \class SFBlockEncoder
+ * @brief Splits the input into blocks and encodes each with its own or a recently used code table
+ *
+ * The encoder keeps the last p_cache_size emitted tables. For every block it compares the
+ * size of the block encoded with each cached table to the size with a new table (including
+ * the bits needed to store that table) and picks the cheapest one. Because the entropy of the
+ * block is a lower bound for every new table, a new table is only built if a cached one is not
+ * already good enough.
+ * If a model is set with setModel() every block is encoded with it in a single pass
+ * without counting the symbols.
+ * With setContextBuckets() the encoder also builds order-1 tables for every block and uses
+ * them if they are smaller than the entropy of the block under an order-0 model.
+ *
+ * With setStreams() blocks that use a single table distribute their symbols round-robin over
+ * several bitstreams (symbol i goes to stream i % streams). The decoder keeps one reader per
+ * stream and decodes one symbol of every stream per iteration. Those symbols do not depend on
+ * each other, so the processor can work on all of them at the same time instead of waiting for
+ * the length of each code before it can start with the next one. Such a block's codes start with the
+ * number of streams (8 bits) and the sizes in bytes of all but the last stream (32 bits each).
+ * Blocks with order-1 tables always use a single stream because every symbol is the context of the next.
+ *
+ * Blocks that would not get smaller (already compressed or encrypted data) are stored as they are.
+ * analyze() recognizes most of them by the entropy of the histogram, which no table can beat, and
+ * builds no tables for them. select() also stores blocks whose chosen table (including the bits of
+ * a new table) would not save anything. The decoder copies stored blocks with memcpy.
+ *
+ * The encoder records every block it writes in index() (positions relative to its first block).
+ *
+ * encodeBlock() runs the four steps of encoding a block one after the other. They can also be
+ * called separately on a Block (see SFPipeline): analyze() and write() only read the configuration of
+ * the encoder and can run on several blocks in parallel, select() (it picks the table from the cache)
+ * and commit() (it adds the block to the index) have to be called for the blocks in their order.
+ * The output is the same either way.
+ */
+class SFBlockEncoder
+{
+public:
+    enum {DEFAULT_BLOCK_SIZE = 1 << 16, DEFAULT_CACHE_SIZE = 4, MAX_STREAMS = 16};
+
+    /**
+     * @brief The Block struct holds a block between the steps of the encoder
+     */
+    struct Block
+    {
+        const char* data = 0;
+        int size = 0;
+        QVector<quint64> histogram;
+        SFContextTable context;     //order-1 tables, only set if they beat every order-0 table
+        SFCodeTable new_table;      //table built from the histogram by analyze(), built by select() if needed otherwise
+        SFCodeTable table;          //table selected by select()
+        SFBlockHeader header;
+        bool stored = false;        //set by analyze() if no table can make the block smaller
+    };
+
+    explicit SFBlockEncoder(int p_block_size = DEFAULT_BLOCK_SIZE, int p_cache_size = DEFAULT_CACHE_SIZE);   //p_block_size up to SFBlockHeader::MAX_SIZE
+
+    void setModel(const SFCodeTable& p_model) {m_model = p_model;}
+    void setContextBuckets(int p_buckets) {m_context_buckets = p_buckets;}  //0 disables order-1 tables
+    void setBuilder(const SFCodeBuilder& p_builder) {m_builder = &p_builder;}
+    void setStreams(int p_streams) {m_streams = p_streams;}               //1 - MAX_STREAMS
+
+    QByteArray encode(const QByteArray& p_input);
+    void encodeBlock(const char* p_data, int p_size, QByteArray& p_out);
+    qint64 encodeBlock(const char* p_data, int p_size, char* p_out, qint64 p_capacity);
+
+    void analyze(Block& p_block, bool p_build_table = false) const;
+    void select(Block& p_block);
+    void write(Block& p_block, SFBitWriter& p_writer) const;
+    void commit(const Block& p_block);
+
+    int builtTables() const {return m_built_tables;}
+    int reusedTables() const {return m_reused_tables;}
+    int storedBlocks() const {return m_stored_blocks;}
+    const SFBlockIndex& index() const {return m_index;}
+
+private:
+    int selectTable(const QVector<quint64>& p_histogram, const SFCodeTable& p_new_table, quint64 p_limit, bool& p_new);
+    quint64 codeBitsLimit(int p_size) const;
+    void writeBlock(const char* p_data, int p_size, SFBitWriter& p_writer);
+    void encodeStreams(const SFCodeTable& p_table, const char* p_data, int p_size, SFBitWriter& p_writer) const;
+
+    QVector<SFCodeTable> m_cache;
+    QVector<qint64> m_slot_position;    //position of the block that wrote the table in every slot
+    SFBlockIndex m_index;
+    SFCodeTable m_model;
+    const SFCodeBuilder* m_builder;
+    int m_next_slot;
+    int m_block_size;
+    int m_context_buckets;
+    int m_streams;
+    int m_built_tables;
+    int m_reused_tables;
+    int m_stored_blocks;
+    qint64 m_position;                  //position of the next block
+};
+
+/**
+ * \class SFBlockDecoder
+ * @brief Decodes the output of SFBlockEncoder
+ *
+ * Besides the QByteArray interface the decoder can write into caller owned buffers (for example
+ * a memory mapped output file) whose size is known in advance from decodedSize().
+ *
+ * decodeRange() uses a SFBlockIndex to decode only the blocks that overlap the requested range.
+ * Tables those blocks reuse are read from the blocks that wrote them and stay cached, so reading
+ * nearby ranges again does not read the tables again.
+ */
+class SFBlockDecoder
+{
+public:
+    explicit SFBlockDecoder(int p_cache_size = SFBlockEncoder::DEFAULT_CACHE_SIZE);
+
+    void setModel(const SFCodeTable& p_model) {m_model = p_model;}
+
+    QByteArray decode(const QByteArray& p_input);
+    qint64 decode(const char* p_input, qint64 p_size, char* p_out, qint64 p_capacity);
+    bool decodeBlock(SFBitReader& p_reader, QByteArray& p_out);
+    qint64 decodeBlock(SFBitReader& p_reader, char* p_out, qint64 p_capacity);
+
+    qint64 decodeRange(const char* p_blocks, qint64 p_size, const SFBlockIndex& p_index,
+                       qint64 p_offset, qint64 p_length, char* p_out);
+
+    static qint64 decodedSize(const char* p_input, qint64 p_size);
+
+private:
+    bool loadTable(const char* p_blocks, qint64 p_size, qint64 p_position);
+    static bool decodeStreams(const SFCodeTable& p_table, const char* p_payload, quint32 p_payload_size,
+                              char* p_out, quint32 p_size);
+
+    QVector<SFCodeTable> m_cache;
+    QVector<qint64> m_slot_position;    //position of the block the table in every slot was read from, -1 if unknown
+    SFCodeTable m_model;
+};
+
+#endif // SFBLOCKCODEC_H
@@ -0,0 +1,158 @@
+#include "sfblockindex.h"
+
+#include <algorithm>
+
+#include "sfblockcodec.h"
+
+SFBlockIndex::SFBlockIndex():
+    m_decoded_size(0)
+{
+
+}
+
+/**
+ * @brief SFBlockIndex::append adds the next block
+ * @param p_entry the block, its offset has to be decodedSize()
+ * @param p_size decoded size of the block
+ */
+void SFBlockIndex::append(const Entry& p_entry, qint64 p_size)
+{
+    Q_ASSERT(p_entry.offset == m_decoded_size);
+
+    m_entries.append(p_entry);
+    m_decoded_size += p_size;
+}
+
+void SFBlockIndex::clear()
+{
+    m_entries.clear();
+    m_decoded_size = 0;
+}
+
+/**
+ * @brief SFBlockIndex::build creates the index of encoded blocks by reading their headers
+ * @param p_blocks the output of SFBlockEncoder
+ * @param p_index is set to the index of the blocks
+ * @return false if a block is cut off or uses a table that was never written
+ *
+ * For data written without an index. Only the headers are read, the bodies are skipped.
+ */
+bool SFBlockIndex::build(const char* p_blocks, qint64 p_size, SFBlockIndex& p_index)
+{
+    QVector<qint64> slot_position(256, -1);     //block that wrote the table of every slot
+    SFBitReader reader(p_blocks, p_size);
+    p_index.clear();
+
+    while(!reader.atEnd())
+    {
+        Entry entry = {p_index.decodedSize(), reader.bytePos(), -1};
+        SFBlockHeader header;
+        if(!header.read(reader) || reader.bytePos() + header.body_size > p_size)
+            return false;
+
+        if(header.usesCache())
+        {
+            if(header.flags & SFBlockHeader::NEW_TABLE)
+                slot_position[header.table_slot] = entry.position;
+            entry.table_position = slot_position.at(header.table_slot);
+            if(entry.table_position < 0)
+                return false;
+        }
+
+        reader.skipBytes(header.body_size);
+        p_index.append(entry, header.size);
+    }
+    return true;
+}
+
+/**
+ * @brief SFBlockIndex::write writes the index (byteSize() bytes) at a byte boundary
+ */
+void SFBlockIndex::write(SFBitWriter& p_writer) const
+{
+    p_writer.flush();
+    for(const Entry& entry:m_entries)
+    {
+        p_writer.writeBits(quint64(entry.offset), 64);
+        p_writer.writeBits(quint64(entry.position), 64);
+        p_writer.writeBits(quint64(entry.table_position), 64);
+    }
+    p_writer.writeBits(quint64(m_decoded_size), 64);
+    p_writer.writeBits(quint64(m_entries.size()), 32);
+}
+
+/**
+ * @brief SFBlockIndex::read reads an index written by SFBlockIndex::write() at the end of p_data
+ * @param p_data the blocks followed by the index
+ * @param p_size size of the blocks and the index. The blocks end at p_size - p_index.byteSize()
+ * @param p_index is set to the index
+ * @return false if there is no valid index at the end of p_data (this includes blocks larger than SFBlockHeader::MAX_SIZE)
+ */
+bool SFBlockIndex::read(const char* p_data, qint64 p_size, SFBlockIndex& p_index)
+{
+    p_index.clear();
+    if(p_size < FOOTER_BYTES)
+        return false;
+
+    SFBitReader footer(p_data + p_size - FOOTER_BYTES, FOOTER_BYTES);
+    qint64 decoded_size = qint64(footer.readBits(64));
+    qint64 count = qint64(footer.readBits(32));
+    qint64 blocks_size = p_size - count*ENTRY_BYTES - FOOTER_BYTES;
+    if(decoded_size < 0 || blocks_size < 0 || (count == 0 && decoded_size != 0))
+        return false;
+
+    SFBitReader reader(p_data + blocks_size, count*ENTRY_BYTES);
+    for(qint64 i = 0; i < count; i++)
+    {
+        Entry entry;
+        entry.offset = qint64(reader.readBits(64));
+        entry.position = qint64(reader.readBits(64));
+        entry.table_position = qint64(reader.readBits(64));
+
+        const Entry* previous = p_index.m_entries.isEmpty() ? 0 : &p_index.m_entries.last();
+        if((previous ? entry.offset < previous->offset || entry.position <= previous->position : entry.offset != 0 || entry.position != 0)
+           || entry.offset > decoded_size || entry.position >= blocks_size
+           || entry.table_position < -1 || entry.table_position > entry.position)
+        {
+            p_index.clear();
+            return false;
+        }
+        if(previous && entry.offset - previous->offset > SFBlockHeader::MAX_SIZE)
+        {
+            p_index.clear();
+            return false;
+        }
+        p_index.m_entries.append(entry);
+    }
+    if(count > 0 && decoded_size - p_index.m_entries.last().offset > SFBlockHeader::MAX_SIZE)
+    {
+        p_index.clear();
+        return false;
+    }
+    p_index.m_decoded_size = decoded_size;
+    return true;
+}
+
+/**
+ * @brief SFBlockIndex::find finds the block containing a decoded byte
+ * @param p_offset offset in the decoded data
+ * @return number of the block or -1 if p_offset is behind the end
+ */
+int SFBlockIndex::find(qint64 p_offset) const
+{
+    if(p_offset < 0 || p_offset >= m_decoded_size)
+        return -1;
+
+    QVector<Entry>::const_iterator it = std::upper_bound(m_entries.constBegin(), m_entries.constEnd(), p_offset,
+                                                         [](qint64 p_value, const Entry& p_entry){return p_value < p_entry.offset;});
+    return int(it - m_entries.constBegin()) - 1;
+}
+
+/**
+ * @brief SFBlockIndex::blockSize returns the decoded size of a block
+ */
+qint64 SFBlockIndex::blockSize(int p_block) const
+{
+    qint64 end = p_block+1 < m_entries.size() ? m_entries.at(p_block+1).offset : m_decoded_size;
+    return end - m_entries.at(p_block).offset;
+}
@@ -0,0 +1,56 @@
+#ifndef SFBLOCKINDEX_H
+#define SFBLOCKINDEX_H
+
+#include <QVector>
+#include <QtGlobal>
+
+#include "sfbitstream.h"
+
+/**
+ * \class SFBlockIndex
+ * @brief Maps offsets in the decoded data to the blocks written by SFBlockEncoder
+ *
+ * Every entry holds the offset of the first decoded byte of a block, the position of the block
+ * in the encoded data and the position of the block whose table it uses (-1 for blocks with a
+ * model or order-1 tables). Blocks that reuse a cached table can be decoded on their own by
+ * reading the table from that block first (see SFBlockDecoder::decodeRange()).
+ *
+ * Layout (written behind the blocks, big endian): offset, position and table position of every
+ * block (64 bits each), the decoded size (64 bits) and the number of blocks (32 bits). The index
+ * is read from the end of the data, so it can be found without reading the blocks.
+ */
+class SFBlockIndex
+{
+public:
+    struct Entry
+    {
+        qint64 offset;          //first decoded byte of the block
+        qint64 position;        //start of the block in the encoded data
+        qint64 table_position;  //start of the block that wrote the table this block uses, -1 if none
+    };
+
+    static const int ENTRY_BYTES = 24;
+    static const int FOOTER_BYTES = 12;
+
+    SFBlockIndex();
+
+    void append(const Entry& p_entry, qint64 p_size);
+    void clear();
+
+    static bool build(const char* p_blocks, qint64 p_size, SFBlockIndex& p_index);
+    void write(SFBitWriter& p_writer) const;
+    static bool read(const char* p_data, qint64 p_size, SFBlockIndex& p_index);
+
+    int find(qint64 p_offset) const;
+    int size() const {return m_entries.size();}
+    const Entry& at(int p_block) const {return m_entries.at(p_block);}
+    qint64 blockSize(int p_block) const;
+    qint64 decodedSize() const {return m_decoded_size;}
+    qint64 byteSize() const {return qint64(m_entries.size())*ENTRY_BYTES + FOOTER_BYTES;}
+
+private:
+    QVector<Entry> m_entries;
+    qint64 m_decoded_size;
+};
+
+#endif // SFBLOCKINDEX_H
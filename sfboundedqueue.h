@@ -0,0 +1,179 @@
+#ifndef SFBOUNDEDQUEUE_H
+#define SFBOUNDEDQUEUE_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+/**
+ * \class SFBoundedQueue
+ * @brief Lock-free queue with a fixed capacity for several producers and consumers
+ *
+ * Every cell carries a sequence number that tells producers and consumers whose turn it is
+ * (the array based queue of Dmitry Vyukov), so push and pop only need one compare-and-swap on the
+ * head or the tail. tryPush() fails if the queue is full, which is how a slow consumer holds back
+ * its producers. push() and pop() wait until they succeed, first spinning and then sleeping,
+ * and return how long they waited so the pipeline can report how busy its stages were.
+ */
+template<class T>
+class SFBoundedQueue
+{
+public:
+    explicit SFBoundedQueue(int p_capacity);
+
+    bool tryPush(const T& p_value);
+    bool tryPop(T& p_value);
+
+    qint64 push(const T& p_value);
+    qint64 pop(T& p_value);
+
+private:
+    Q_DISABLE_COPY(SFBoundedQueue)
+
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static void backoff(int p_round);
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask;
+    alignas(64) std::atomic<size_t> m_tail;     //next cell to push to
+    alignas(64) std::atomic<size_t> m_head;     //next cell to pop from
+};
+
+/**
+ * @brief SFBoundedQueue::SFBoundedQueue creates an empty queue
+ * @param p_capacity maximum number of elements, rounded up to a power of two
+ */
+template<class T>
+SFBoundedQueue<T>::SFBoundedQueue(int p_capacity):
+    m_tail(0),
+    m_head(0)
+{
+    size_t capacity = 2;
+    while(capacity < size_t(p_capacity))
+        capacity *= 2;
+
+    m_cells.reset(new Cell[capacity]);
+    m_mask = capacity - 1;
+    for(size_t i = 0; i < capacity; i++)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+/**
+ * @brief SFBoundedQueue::tryPush appends p_value if the queue is not full
+ * @return false if the queue is full
+ */
+template<class T>
+bool SFBoundedQueue<T>::tryPush(const T& p_value)
+{
+    size_t pos = m_tail.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        qint64 diff = qint64(sequence) - qint64(pos);
+        if(diff == 0)                       //the cell is free, try to claim it
+        {
+            if(m_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                cell.value = p_value;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if(diff < 0)                   //the cell still holds the element of the previous round
+        {
+            return false;
+        }
+        else                                //another producer claimed the cell
+        {
+            pos = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief SFBoundedQueue::tryPop removes the first element if the queue is not empty
+ * @return false if the queue is empty
+ */
+template<class T>
+bool SFBoundedQueue<T>::tryPop(T& p_value)
+{
+    size_t pos = m_head.load(std::memory_order_relaxed);
+    for(;;)
+    {
+        Cell& cell = m_cells[pos & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        qint64 diff = qint64(sequence) - qint64(pos + 1);
+        if(diff == 0)                       //the cell is filled, try to claim it
+        {
+            if(m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                p_value = cell.value;
+                cell.sequence.store(pos + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if(diff < 0)                   //nothing was pushed to the cell yet
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief SFBoundedQueue::push appends p_value, waiting while the queue is full
+ * @return nanoseconds spent waiting
+ */
+template<class T>
+qint64 SFBoundedQueue<T>::push(const T& p_value)
+{
+    if(tryPush(p_value))
+        return 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int round = 0; !tryPush(p_value); round++)
+        backoff(round);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief SFBoundedQueue::pop removes the first element, waiting while the queue is empty
+ * @return nanoseconds spent waiting
+ */
+template<class T>
+qint64 SFBoundedQueue<T>::pop(T& p_value)
+{
+    if(tryPop(p_value))
+        return 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int round = 0; !tryPop(p_value); round++)
+        backoff(round);
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief SFBoundedQueue::backoff waits a little longer in every round (up to 50 microseconds)
+ */
+template<class T>
+void SFBoundedQueue<T>::backoff(int p_round)
+{
+    if(p_round < 16)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(p_round < 64 ? 5 : 50));
+}
+
+#endif // SFBOUNDEDQUEUE_H
@@ -0,0 +1,1029 @@
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QStringList>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "sfbatchcodec.h"
+#include "sfblockcodec.h"
+#include "sfdirectorycompressor.h"
+#include "sfmodel.h"
+#include "sfpipeline.h"
+#include "sftelemetry.h"
+#include "sftokencodec.h"
+#ifdef Q_OS_UNIX
+#include "sfserver.h"
+#endif
+
+/*
+ * sfc - command line interface of the Shannon Fano codec
+ *
+ * sfc train [-a builder] <model> <sample>...        builds a model from a sample corpus
+ * sfc compress [-m model] [-b size] [-c buckets] [-a builder] [-s streams] [-j threads] [-v] <in> <out>
+ *                                                   compresses a file (in blocks of size bytes, with
+ *                                                   order-1 tables for up to buckets contexts and
+ *                                                   the given number of interleaved streams) with
+ *                                                   SFPipeline (threads analyze and encode threads,
+ *                                                   -v prints how busy every stage was)
+ * sfc compress-dir [options of compress] <out dir> <in>...
+ *                                                   compresses directory trees, files and @lists of
+ *                                                   files into out dir with SFDirectoryCompressor
+ * sfc decompress [-m model] <in> <out>              decompresses a file
+ * sfc extract [-m model] <in> <offset> <length> <out>
+ *                                                   decompresses length bytes starting at offset
+ * sfc bench [-b size] [-c buckets] [-s streams] <file>...
+ *                                                   compares the code builders on the given files
+ * sfc serve [-j threads] [-d model dir] <socket> [model]...
+ *                                                   compresses and decompresses payloads sent to a
+ *                                                   Unix domain socket (see SFServer)
+ * sfc loadgen [-m model] [-j connections] [-n requests] [-p payload size] [-r swap ms] <socket> <sample>
+ *                                                   sends round trips of payloads of the sample to a
+ *                                                   server and reports latency and requests per second
+ * sfc model <socket> (load <model name> | train <sample> | drop <id>)
+ *                                                   adds or removes a model of a running server
+ *
+ * builder is one of the names of SFCodeBuilder::builders() (default shannon-fano). The decoder
+ * does not need to know the builder because the codes are stored with the blocks.
+ *
+ * A compressed file starts with the magic "SFC2" and the id of the model it was compressed
+ * with (32 bit, 0 = no model) followed by the blocks written by SFBlockEncoder and their
+ * SFBlockIndex, so ranges can be extracted without decoding the file from the start.
+ * Files of the older format "SFC1" have no index, it is built from the block headers.
+ */
+
+static const char STREAM_MAGIC[] = "SFC2";
+static const char STREAM_MAGIC_V1[] = "SFC1";
+static const int STREAM_HEADER_SIZE = 8;
+static const qint64 EXTRACT_PIECE_SIZE = 16 << 20;
+
+static int usage()
+{
+    std::cerr << "usage: sfc train [-a builder] <model> <sample>..." << std::endl
+              << "       sfc compress [-m model] [-b block size] [-c context buckets] [-a builder] [-s streams] [-j threads] [-v] <input> <output>" << std::endl
+              << "       sfc compress-dir [-m model] [-b block size] [-c context buckets] [-a builder] [-s streams] [-j threads] [-v] <output dir> <input>..." << std::endl
+              << "       sfc decompress [-m model] <input> <output>" << std::endl
+              << "       sfc extract [-m model] <input> <offset> <length> <output>" << std::endl
+              << "       sfc bench [-b block size] [-c context buckets] [-s streams] <file>..." << std::endl
+              << "       sfc serve [-j threads] [-d model dir] <socket> [model]..." << std::endl
+              << "       sfc loadgen [-m model] [-j connections] [-n requests] [-p payload size] [-r swap ms] <socket> <sample>" << std::endl
+              << "       sfc model <socket> (load <model name> | train <sample> | drop <id>)" << std::endl
+              << "builders:";
+    for(const SFCodeBuilder* builder:SFCodeBuilder::builders())
+        std::cerr << " " << builder->name().toStdString();
+    std::cerr << std::endl;
+    return 2;
+}
+
+/**
+ * @brief The Options struct holds the options shared by the commands
+ */
+struct Options
+{
+    QString model;                                          //-m
+    int block_size = SFBlockEncoder::DEFAULT_BLOCK_SIZE;    //-b
+    int buckets = 0;                                        //-c
+    const SFCodeBuilder* builder = &SFCodeBuilder::shannonFano();  //-a
+    int streams = 1;                                        //-s
+    int threads = int(qMax(std::thread::hardware_concurrency(), 1u));    //-j
+    bool verbose = false;                                   //-v
+};
+
+/**
+ * @brief takeOptions removes the options -m, -b, -c, -a, -s, -j and -v from p_args
+ * @return false if an option is incomplete or invalid
+ */
+static bool takeOptions(QStringList& p_args, Options& p_options)
+{
+    QStringList rest;
+    for(int i = 0; i < p_args.size(); i++)
+    {
+        const QString& arg = p_args.at(i);
+        if((arg == "-m" || arg == "-b" || arg == "-c" || arg == "-a" || arg == "-s" || arg == "-j") && i+1 >= p_args.size())
+            return false;
+
+        bool ok = true;
+        if(arg == "-m")
+        {
+            p_options.model = p_args.at(++i);
+        }
+        else if(arg == "-b")
+        {
+            p_options.block_size = p_args.at(++i).toInt(&ok);
+            ok = ok && p_options.block_size > 0 && p_options.block_size <= SFBlockHeader::MAX_SIZE;
+        }
+        else if(arg == "-c")
+        {
+            int buckets = p_options.buckets = p_args.at(++i).toInt(&ok);
+            ok = ok && buckets > 0 && buckets <= SFContextTable::MAX_BUCKETS && !(buckets & (buckets-1));
+        }
+        else if(arg == "-a")
+        {
+            p_options.builder = SFCodeBuilder::fromName(p_args.at(++i));
+            ok = p_options.builder != 0;
+        }
+        else if(arg == "-s")
+        {
+            p_options.streams = p_args.at(++i).toInt(&ok);
+            ok = ok && p_options.streams > 0 && p_options.streams <= SFBlockEncoder::MAX_STREAMS;
+        }
+        else if(arg == "-j")
+        {
+            p_options.threads = p_args.at(++i).toInt(&ok);
+            ok = ok && p_options.threads > 0;
+        }
+        else if(arg == "-v")
+        {
+            p_options.verbose = true;
+        }
+        else
+        {
+            rest.append(arg);
+        }
+
+        if(!ok)
+            return false;
+    }
+    p_args = rest;
+    return true;
+}
+
+/**
+ * @brief loadModel loads p_file_name into p_model if a file name was given
+ */
+static bool loadModel(const QString& p_file_name, SFModel& p_model)
+{
+    if(p_file_name.isEmpty() || p_model.load(p_file_name))
+        return true;
+
+    std::cerr << "sfc: can not load model " << p_file_name.toStdString() << std::endl;
+    return false;
+}
+
+static int train(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options) || p_args.size() < 2)
+        return usage();
+
+    SFCodeTable table = SFModel::train(SFModel::histogramOfFiles(p_args.mid(1)), *options.builder);
+    if(!SFModel::save(table, p_args.at(0)))
+    {
+        std::cerr << "sfc: can not write " << p_args.at(0).toStdString() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief megabytesPerSecond converts a number of bytes processed in p_nsecs nanoseconds to MB/s
+ */
+static double megabytesPerSecond(qint64 p_bytes, qint64 p_nsecs)
+{
+    return p_nsecs > 0 ? (double(p_bytes)/(1 << 20))/(double(p_nsecs)/1e9) : 0;
+}
+
+static int compress(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options) || p_args.size() != 2)
+        return usage();
+
+    SFModel model;
+    if(!loadModel(options.model, model))
+        return 1;
+
+    QFile input(p_args.at(0)), output(p_args.at(1));
+    if(!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        std::cerr << "sfc: can not open " << (input.isOpen() ? p_args.at(1) : p_args.at(0)).toStdString() << std::endl;
+        return 1;
+    }
+
+    SFBlockEncoder encoder(options.block_size);
+    encoder.setContextBuckets(options.buckets);
+    encoder.setBuilder(*options.builder);
+    encoder.setStreams(options.streams);
+    if(model.isLoaded())
+        encoder.setModel(model.table());
+
+    QByteArray buffer(STREAM_MAGIC);
+    SFBitWriter writer(&buffer);
+    writer.writeBits(model.id(), 32);
+    if(output.write(buffer) != buffer.size())
+        return 1;
+
+    SFPipeline pipeline(encoder, options.block_size, options.threads);
+    if(!pipeline.run(input, output))
+    {
+        std::cerr << "sfc: can not compress " << p_args.at(0).toStdString() << std::endl;
+        return 1;
+    }
+
+    buffer.resize(0);
+    encoder.index().write(writer);
+    if(output.write(buffer) != buffer.size())
+        return 1;
+
+    if(options.verbose)
+    {
+        double elapsed = double(qMax(pipeline.elapsedNsecs(), qint64(1)));
+        std::cerr << std::setw(10) << "stage" << std::setw(9) << "threads" << std::setw(9) << "blocks"
+                  << std::setw(11) << "busy ms" << std::setw(9) << "busy %" << std::endl
+                  << std::fixed;
+        for(const SFPipeline::StageStats& stage:pipeline.stats())
+        {
+            std::cerr << std::setw(10) << stage.name.toStdString() << std::setw(9) << stage.threads << std::setw(9) << stage.items
+                      << std::setw(11) << std::setprecision(1) << stage.busy_nsecs/1e6
+                      << std::setw(9) << 100.0*stage.busy_nsecs/(elapsed*stage.threads) << std::endl;
+        }
+        std::cerr << "total " << std::setprecision(1) << elapsed/1e6 << " ms, "
+                  << megabytesPerSecond(input.size(), pipeline.elapsedNsecs()) << " MB/s, "
+                  << encoder.storedBlocks() << " blocks stored" << std::endl;
+    }
+    return 0;
+}
+
+/**
+ * @brief outputPath returns where compress-dir writes the compressed p_relative_path
+ *
+ * Leading "/" and "../" are removed, so every output ends up inside p_output_dir.
+ */
+static QString outputPath(const QString& p_output_dir, QString p_relative_path)
+{
+    p_relative_path = QDir::cleanPath(p_relative_path);
+    while(p_relative_path.startsWith("/") || p_relative_path.startsWith("../"))
+        p_relative_path.remove(0, p_relative_path.startsWith("/") ? 1 : 3);
+    return p_output_dir + "/" + p_relative_path + ".sfc";
+}
+
+static int compressDir(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options) || p_args.size() < 2)
+        return usage();
+
+    SFModel model;
+    if(!loadModel(options.model, model))
+        return 1;
+
+    //directories are compressed recursively (outputs relative to the directory), "@list" names a
+    //file with one input per line, other inputs are files (outputs relative to the working directory)
+    QString output_dir = p_args.takeFirst();
+    QVector<SFDirectoryCompressor::File> files;
+    qint64 input_bytes = 0;
+    for(const QString& input:p_args)
+    {
+        QStringList paths(input);
+        if(input.startsWith("@"))
+        {
+            QFile list(input.mid(1));
+            if(!list.open(QIODevice::ReadOnly))
+            {
+                std::cerr << "sfc: can not read " << input.mid(1).toStdString() << std::endl;
+                return 1;
+            }
+            paths.clear();
+            for(const QByteArray& line:list.readAll().split('\n'))
+            {
+                if(!line.trimmed().isEmpty())
+                    paths.append(QString::fromLocal8Bit(line.trimmed()));
+            }
+        }
+
+        for(const QString& path:paths)
+        {
+            QFileInfo info(path);
+            if(info.isDir())
+            {
+                QDir dir(path);
+                QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+                while(it.hasNext())
+                {
+                    QString file = it.next();
+                    files.append({file, outputPath(output_dir, dir.relativeFilePath(file)), QFileInfo(file).size()});
+                }
+            }
+            else if(info.exists())
+            {
+                files.append({path, outputPath(output_dir, path), info.size()});
+            }
+            else
+            {
+                std::cerr << "sfc: " << path.toStdString() << " does not exist" << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    //a file given twice is compressed once, different files must not share an output (e.g. "a/x" and "b/x",
+    //or "x" and "../x") because their tasks would write it at the same time
+    QHash<QString, QString> inputs;     //output -> canonical path of the input
+    QVector<SFDirectoryCompressor::File> unique;
+    for(const SFDirectoryCompressor::File& file:files)
+    {
+        QString canonical = QFileInfo(file.input).canonicalFilePath();
+        QHash<QString, QString>::const_iterator it = inputs.constFind(file.output);
+        if(it == inputs.constEnd())
+        {
+            inputs.insert(file.output, canonical);
+            unique.append(file);
+        }
+        else if(it.value() != canonical)
+        {
+            std::cerr << "sfc: " << it.value().toStdString() << " and " << canonical.toStdString()
+                      << " would both be written to " << file.output.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    files = unique;
+
+    QDir root;
+    for(const SFDirectoryCompressor::File& file:files)
+    {
+        input_bytes += file.size;
+        if(!root.mkpath(QFileInfo(file.output).absolutePath()))
+        {
+            std::cerr << "sfc: can not create the directory of " << file.output.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    std::stable_sort(files.begin(), files.end(), [](const SFDirectoryCompressor::File& a, const SFDirectoryCompressor::File& b) {
+        return a.size > b.size;     //the largest files are started (and split) first
+    });
+
+    SFBlockEncoder encoder(options.block_size);
+    encoder.setContextBuckets(options.buckets);
+    encoder.setBuilder(*options.builder);
+    encoder.setStreams(options.streams);
+    if(model.isLoaded())
+        encoder.setModel(model.table());
+
+    QByteArray header(STREAM_MAGIC);
+    SFBitWriter writer(&header);
+    writer.writeBits(model.id(), 32);
+
+    QElapsedTimer timer;
+    timer.start();
+    SFDirectoryCompressor compressor(encoder, options.block_size, header);
+    bool ok = compressor.run(files, options.threads);
+    qint64 elapsed = timer.nsecsElapsed();
+
+    for(const QString& failed:compressor.failed())
+        std::cerr << "sfc: can not compress " << failed.toStdString() << std::endl;
+
+    std::cout << files.size() << " files (" << compressor.splitFiles() << " split into blocks, " << compressor.batches()
+              << " batches of small files), " << input_bytes << " -> " << compressor.outputBytes() << " bytes in "
+              << std::fixed << std::setprecision(2) << elapsed/1e9 << " s, " << std::setprecision(1)
+              << megabytesPerSecond(input_bytes, elapsed) << " MB/s" << std::endl;
+    if(options.verbose)
+    {
+        std::cerr << std::setw(8) << "thread" << std::setw(9) << "tasks" << std::setw(9) << "stolen" << std::setw(9) << "busy %" << std::endl
+                  << std::fixed << std::setprecision(1);
+        for(size_t i = 0; i < compressor.threadStats().size(); i++)
+        {
+            const SFTaskPool::ThreadStats& stats = compressor.threadStats()[i];
+            std::cerr << std::setw(8) << i << std::setw(9) << stats.tasks << std::setw(9) << stats.stolen
+                      << std::setw(9) << 100.0*stats.busy_nsecs/double(qMax(elapsed, qint64(1))) << std::endl;
+        }
+    }
+    return ok ? 0 : 1;
+}
+
+/**
+ * @brief The Archive struct describes a mapped compressed file
+ */
+struct Archive
+{
+    const char* blocks = 0;
+    qint64 size = 0;            //size of the blocks without the index
+    SFBlockIndex index;
+};
+
+/**
+ * @brief openArchive maps a compressed file and reads its index
+ * @param p_input the opened file
+ * @param p_model the model given on the command line, it has to be the one the file was compressed with
+ * @return false (after printing the reason) if the file can not be decompressed
+ */
+static bool openArchive(QFile& p_input, const SFModel& p_model, Archive& p_archive)
+{
+    std::string name = p_input.fileName().toStdString();
+    const char* data = reinterpret_cast<const char*>(p_input.map(0, p_input.size()));
+    bool indexed = data && p_input.size() >= STREAM_HEADER_SIZE && std::memcmp(data, STREAM_MAGIC, 4) == 0;
+    if(!indexed && (!data || p_input.size() < STREAM_HEADER_SIZE || std::memcmp(data, STREAM_MAGIC_V1, 4) != 0))
+    {
+        std::cerr << "sfc: " << name << " is not compressed by sfc" << std::endl;
+        return false;
+    }
+
+    SFBitReader header(data + 4, 4);
+    if(quint32(header.readBits(32)) != p_model.id())
+    {
+        std::cerr << "sfc: " << name << " needs a different model" << std::endl;
+        return false;
+    }
+
+    p_archive.blocks = data + STREAM_HEADER_SIZE;
+    p_archive.size = p_input.size() - STREAM_HEADER_SIZE;
+    if(indexed ? !SFBlockIndex::read(p_archive.blocks, p_archive.size, p_archive.index)
+               : !SFBlockIndex::build(p_archive.blocks, p_archive.size, p_archive.index))
+    {
+        std::cerr << "sfc: " << name << " is corrupted" << std::endl;
+        return false;
+    }
+    if(indexed)
+        p_archive.size -= p_archive.index.byteSize();
+    return true;
+}
+
+static int decompress(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options) || p_args.size() != 2)
+        return usage();
+
+    SFModel model;
+    if(!loadModel(options.model, model))
+        return 1;
+
+    QFile input(p_args.at(0)), output(p_args.at(1));
+    if(!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::ReadWrite | QIODevice::Truncate))
+    {
+        std::cerr << "sfc: can not open " << (input.isOpen() ? p_args.at(1) : p_args.at(0)).toStdString() << std::endl;
+        return 1;
+    }
+
+    Archive archive;
+    if(!openArchive(input, model, archive))
+        return 1;
+
+    SFBlockDecoder decoder;
+    if(model.isLoaded())
+        decoder.setModel(model.table());
+
+    //the blocks are decoded directly into the mapped output file
+    qint64 size = archive.index.decodedSize();
+    char* out = 0;
+    if(size > 0 && (!output.resize(size) || !(out = reinterpret_cast<char*>(output.map(0, size)))))
+    {
+        std::cerr << "sfc: can not map " << p_args.at(1).toStdString() << std::endl;
+        return 1;
+    }
+
+    if(decoder.decode(archive.blocks, archive.size, out, size) != size)
+    {
+        std::cerr << "sfc: " << p_args.at(0).toStdString() << " is corrupted" << std::endl;
+        output.resize(0);
+        return 1;
+    }
+    return 0;
+}
+
+static int extract(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options) || p_args.size() != 4)
+        return usage();
+
+    bool offset_ok = false, length_ok = false;
+    qint64 offset = p_args.at(1).toLongLong(&offset_ok);
+    qint64 length = p_args.at(2).toLongLong(&length_ok);
+    if(!offset_ok || !length_ok || offset < 0 || length < 0)
+        return usage();
+
+    SFModel model;
+    if(!loadModel(options.model, model))
+        return 1;
+
+    QFile input(p_args.at(0)), output(p_args.at(3));
+    if(!input.open(QIODevice::ReadOnly) || !output.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        std::cerr << "sfc: can not open " << (input.isOpen() ? p_args.at(3) : p_args.at(0)).toStdString() << std::endl;
+        return 1;
+    }
+
+    Archive archive;
+    if(!openArchive(input, model, archive))
+        return 1;
+    if(offset + length > archive.index.decodedSize())
+    {
+        std::cerr << "sfc: " << p_args.at(0).toStdString() << " has only " << archive.index.decodedSize() << " bytes" << std::endl;
+        return 1;
+    }
+
+    SFBlockDecoder decoder;
+    if(model.isLoaded())
+        decoder.setModel(model.table());
+
+    //the range is decoded and written in pieces, so it may be larger than the memory (or than a QByteArray)
+    QByteArray piece;
+    for(qint64 done = 0; done < length; done += piece.size())
+    {
+        piece.resize(int(qMin(length - done, EXTRACT_PIECE_SIZE)));
+        if(decoder.decodeRange(archive.blocks, archive.size, archive.index, offset + done, piece.size(), piece.data()) != piece.size())
+        {
+            std::cerr << "sfc: " << p_args.at(0).toStdString() << " is corrupted" << std::endl;
+            return 1;
+        }
+        if(output.write(piece) != piece.size())
+            return 1;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief bench compresses every file with every builder and prints one line per builder
+ *
+ * build ms is the time spent building the tables of all blocks, encode includes the building.
+ * The blocks are decoded once from a single stream and once from -s (default 4) interleaved
+ * streams, speedup is the ratio of the two decode times. Every result is compared to the input.
+ * The lines of every file are encoded as messages, once every line as a block of its own and once
+ * all lines in one SFBatchEncoder batch. Files that only contain symbols of SFTelemetryDigits are
+ * also encoded with the compile-time table.
+ */
+static int bench(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options) || p_args.isEmpty() || !options.model.isEmpty())
+        return usage();
+    int streams = options.streams > 1 ? options.streams : 4;
+
+    if(!SFTelemetryCodec::check())
+    {
+        std::cerr << "sfc: the static telemetry table differs from SFCodeTable::fromHistogram()" << std::endl;
+        return 1;
+    }
+
+    for(const QString& file_name:p_args)
+    {
+        QFile input(file_name);
+        if(!input.open(QIODevice::ReadOnly))
+        {
+            std::cerr << "sfc: can not open " << file_name.toStdString() << std::endl;
+            return 1;
+        }
+        QByteArray data = input.readAll();
+
+        std::cout << file_name.toStdString() << " (" << data.size() << " bytes)" << std::endl
+                  << std::left << std::setw(14) << "builder" << std::right
+                  << std::setw(10) << "ratio %" << std::setw(10) << "build ms"
+                  << std::setw(14) << "encode MB/s" << std::setw(14) << "decode MB/s"
+                  << std::setw(10) << ("x" + std::to_string(streams) + " MB/s") << std::setw(10) << "speedup" << std::endl;
+
+        for(const SFCodeBuilder* candidate:SFCodeBuilder::builders())
+        {
+            QElapsedTimer timer;
+            timer.start();
+            for(int pos = 0; pos < data.size(); pos += options.block_size)
+            {
+                int size = qMin(options.block_size, data.size() - pos);
+                SFCodeTable::fromHistogram(SFCodeTable::histogram(data.constData() + pos, size), *candidate);
+            }
+            qint64 build_nsecs = timer.nsecsElapsed();
+
+            SFBlockEncoder encoder(options.block_size), multi_encoder(options.block_size);
+            encoder.setContextBuckets(options.buckets);
+            encoder.setBuilder(*candidate);
+            multi_encoder.setContextBuckets(options.buckets);
+            multi_encoder.setBuilder(*candidate);
+            multi_encoder.setStreams(streams);
+
+            timer.start();
+            QByteArray encoded = encoder.encode(data);
+            qint64 encode_nsecs = timer.nsecsElapsed();
+            QByteArray multi_encoded = multi_encoder.encode(data);
+
+            SFBlockDecoder decoder, multi_decoder;
+            timer.start();
+            QByteArray decoded = decoder.decode(encoded);
+            qint64 decode_nsecs = timer.nsecsElapsed();
+
+            timer.start();
+            QByteArray multi_decoded = multi_decoder.decode(multi_encoded);
+            qint64 multi_decode_nsecs = timer.nsecsElapsed();
+
+            if(decoded != data || multi_decoded != data)
+            {
+                std::cerr << "sfc: " << candidate->name().toStdString() << " failed on " << file_name.toStdString() << std::endl;
+                return 1;
+            }
+
+            std::cout << std::left << std::setw(14) << candidate->name().toStdString() << std::right << std::fixed
+                      << std::setw(10) << std::setprecision(2) << (data.size() ? 100.0*encoded.size()/data.size() : 0.0)
+                      << std::setw(10) << std::setprecision(2) << build_nsecs/1e6
+                      << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), encode_nsecs)
+                      << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), decode_nsecs)
+                      << std::setw(10) << std::setprecision(1) << megabytesPerSecond(data.size(), multi_decode_nsecs)
+                      << std::setw(10) << std::setprecision(2)
+                      << (multi_decode_nsecs > 0 ? double(decode_nsecs)/double(multi_decode_nsecs) : 0.0) << std::endl;
+        }
+
+        //the whole file over an alphabet extended by frequent digrams, trigrams and words (see SFTokenAlphabet)
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray encoded = SFTokenEncoder().encode(data);
+        qint64 encode_nsecs = timer.nsecsElapsed();
+        timer.start();
+        QByteArray decoded = SFTokenDecoder::decode(encoded);
+        qint64 decode_nsecs = timer.nsecsElapsed();
+        if(decoded != data)
+        {
+            std::cerr << "sfc: tokens failed on " << file_name.toStdString() << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(14) << "tokens" << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << (data.size() ? 100.0*encoded.size()/data.size() : 0.0)
+                  << std::setw(10) << "-"
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), encode_nsecs)
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), decode_nsecs) << std::endl;
+
+        //every line as a message, encoded separately and in one batch
+        QVector<quint32> offsets(1, 0);
+        for(int pos = 0; pos < data.size(); )
+        {
+            int end = data.indexOf('\n', pos);
+            pos = end < 0 ? data.size() : end + 1;
+            offsets.append(quint32(pos));
+        }
+        int lines = offsets.size() - 1;
+
+        qint64 line_blocks_size = 0;
+        QByteArray line_blocks_decoded;
+        timer.start();
+        QVector<QByteArray> line_blocks(lines);
+        for(int line = 0; line < lines; line++)
+        {
+            SFBlockEncoder line_encoder;
+            line_encoder.encodeBlock(data.constData() + offsets.at(line), int(offsets.at(line + 1) - offsets.at(line)), line_blocks[line]);
+            line_blocks_size += line_blocks.at(line).size();
+        }
+        encode_nsecs = timer.nsecsElapsed();
+        timer.start();
+        for(const QByteArray& block:line_blocks)
+            line_blocks_decoded += SFBlockDecoder().decode(block);
+        decode_nsecs = timer.nsecsElapsed();
+        if(line_blocks_decoded != data)
+        {
+            std::cerr << "sfc: line blocks failed on " << file_name.toStdString() << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(14) << "line blocks" << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << (data.size() ? 100.0*line_blocks_size/data.size() : 0.0)
+                  << std::setw(10) << "-"
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), encode_nsecs)
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), decode_nsecs) << std::endl;
+
+        QByteArray batch;
+        timer.start();
+        SFBatchEncoder().encode(data.constData(), offsets.constData(), lines, batch);
+        encode_nsecs = timer.nsecsElapsed();
+        SFBatchDecoder batch_decoder;
+        QByteArray batch_decoded;
+        timer.start();
+        if(batch_decoder.open(batch.constData(), batch.size()) && batch_decoder.decodedSize() == data.size())
+        {
+            batch_decoded.resize(data.size());
+            if(!batch_decoder.decodeAll(batch_decoded.data()))
+                batch_decoded.clear();
+        }
+        decode_nsecs = timer.nsecsElapsed();
+        if(batch_decoded != data)
+        {
+            std::cerr << "sfc: line batch failed on " << file_name.toStdString() << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(14) << "line batch" << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << (data.size() ? 100.0*batch.size()/data.size() : 0.0)
+                  << std::setw(10) << "-"
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), encode_nsecs)
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), decode_nsecs) << std::endl;
+
+        //the constant table of SFTelemetryDigits, no table is built or written
+        QVector<quint64> histogram = SFCodeTable::histogram(data.constData(), data.size());
+        bool telemetry = true;
+        for(int sym = 0; sym < histogram.size() && telemetry; sym++)
+            telemetry = histogram.at(sym) == 0 || (sym < SFTelemetryCodec::ALPHABET_SIZE && SFTelemetryCodec::CODES.length[sym] > 0);
+        if(!telemetry)
+            continue;
+
+        QByteArray static_encoded;
+        SFBitWriter writer(&static_encoded);
+        timer.start();
+        SFTelemetryCodec::encode(reinterpret_cast<const uchar*>(data.constData()), data.size(), writer);
+        writer.flush();
+        encode_nsecs = timer.nsecsElapsed();
+
+        QByteArray static_decoded(data.size(), '\0');
+        SFBitReader reader(static_encoded);
+        timer.start();
+        qint64 count = SFTelemetryCodec::decode(reader, reinterpret_cast<uchar*>(static_decoded.data()), static_decoded.size());
+        decode_nsecs = timer.nsecsElapsed();
+        if(count != data.size() || static_decoded != data)
+        {
+            std::cerr << "sfc: telemetry failed on " << file_name.toStdString() << std::endl;
+            return 1;
+        }
+        std::cout << std::left << std::setw(14) << "telemetry" << std::right << std::fixed
+                  << std::setw(10) << std::setprecision(2) << (data.size() ? 100.0*static_encoded.size()/data.size() : 0.0)
+                  << std::setw(10) << "-"
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), encode_nsecs)
+                  << std::setw(14) << std::setprecision(1) << megabytesPerSecond(data.size(), decode_nsecs) << std::endl;
+    }
+    return 0;
+}
+
+#ifdef Q_OS_UNIX
+static int serve(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options))
+        return usage();
+
+    SFServer server;
+    int dir = p_args.indexOf("-d");     //the option only serve has
+    if(dir >= 0)
+    {
+        if(dir + 1 >= p_args.size())
+            return usage();
+        if(!server.setModelDirectory(p_args.at(dir+1)))
+        {
+            std::cerr << "sfc: " << p_args.at(dir+1).toStdString() << " is not a directory" << std::endl;
+            return 1;
+        }
+        p_args.removeAt(dir);
+        p_args.removeAt(dir);
+    }
+    if(p_args.size() < 1)
+        return usage();
+
+    for(const QString& model:p_args.mid(1))
+    {
+        if(!server.addModel(model))
+        {
+            std::cerr << "sfc: can not load model " << model.toStdString() << std::endl;
+            return 1;
+        }
+    }
+    if(!server.listen(p_args.at(0)))
+    {
+        std::cerr << "sfc: can not listen on " << p_args.at(0).toStdString() << std::endl;
+        return 1;
+    }
+
+    std::cerr << "sfc: listening on " << p_args.at(0).toStdString() << " with " << qMin(options.threads, int(SFServer::MAX_THREADS)) << " threads, models:";
+    for(quint32 id:server.modelIds())
+        std::cerr << " " << id;
+    std::cerr << std::endl;
+
+    server.start(options.threads);
+    server.wait();
+    return 0;
+}
+
+/**
+ * @brief percentile returns the p_percent percentile of sorted latencies in microseconds
+ */
+static double percentile(const std::vector<qint64>& p_sorted_nsecs, int p_percent)
+{
+    if(p_sorted_nsecs.empty())
+        return 0.0;
+    size_t pos = qMin(p_sorted_nsecs.size() - 1, p_sorted_nsecs.size()*size_t(p_percent)/100);
+    return p_sorted_nsecs[pos]/1e3;
+}
+
+static int loadgen(QStringList p_args)
+{
+    Options options;
+    if(!takeOptions(p_args, options))
+        return usage();
+
+    int requests = 10000, payload_size = 1024, swap_msecs = 0;
+    for(int i = 0; i + 1 < p_args.size(); i++)     //the options only loadgen has
+    {
+        int* value = p_args.at(i) == "-n" ? &requests : p_args.at(i) == "-p" ? &payload_size : p_args.at(i) == "-r" ? &swap_msecs : 0;
+        if(!value)
+            continue;
+        bool ok = false;
+        *value = p_args.at(i+1).toInt(&ok);
+        if(!ok || *value < (value == &swap_msecs ? 0 : 1))
+            return usage();
+        p_args.removeAt(i);
+        p_args.removeAt(i);
+        i--;
+    }
+    if(p_args.size() != 2)
+        return usage();
+
+    SFModel model;
+    if(!loadModel(options.model, model))
+        return 1;
+
+    QFile file(p_args.at(1));
+    if(!file.open(QIODevice::ReadOnly) || file.size() == 0)
+    {
+        std::cerr << "sfc: can not read " << p_args.at(1).toStdString() << std::endl;
+        return 1;
+    }
+    QByteArray sample = file.readAll();
+    payload_size = qMin(payload_size, sample.size());
+
+    //every connection sends its share of the round trips (compress, then decompress the result)
+    int connections = options.threads;
+    std::vector<std::vector<qint64>> compress_nsecs(connections), decompress_nsecs(connections);
+    std::atomic<qint64> compressed_bytes(0);
+    std::atomic<bool> failed(false), done(false);
+    std::atomic<int> swaps(0);
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    //with -r the server trains a new model from a slice of the sample every swap_msecs and drops the previous one
+    std::thread swapper;
+    if(swap_msecs > 0)
+    {
+        swapper = std::thread([&]() {
+            SFClient client;
+            if(!client.connect(p_args.at(0)))
+            {
+                failed = true;
+                return;
+            }
+            QByteArray response;
+            quint32 previous = 0;
+            for(int i = 0; !done && !failed; i++)
+            {
+                QByteArray slice = sample.mid(int((qint64(i)*4096) % sample.size()), 64*1024);
+                if(client.request(SFProtocol::TRAIN_MODEL, 0, slice, response) != SFProtocol::OK || response.size() != 4)
+                {
+                    failed = true;
+                    return;
+                }
+                quint32 id = qFromBigEndian<quint32>(response.constData());
+                if(previous != 0 && previous != id && previous != model.id())
+                    client.request(SFProtocol::DROP_MODEL, previous, QByteArray(), response);
+                previous = id;
+                swaps++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(swap_msecs));
+            }
+        });
+    }
+    for(int c = 0; c < connections; c++)
+    {
+        threads.push_back(std::thread([&, c]() {
+            SFClient client;
+            if(!client.connect(p_args.at(0)))
+            {
+                failed = true;
+                return;
+            }
+            QByteArray compressed, decompressed;
+            for(int i = c; i < requests && !failed; i += connections)
+            {
+                QByteArray payload = sample.mid(int((qint64(i)*payload_size) % (sample.size() - payload_size + 1)), payload_size);
+
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                int status = client.request(SFProtocol::COMPRESS, model.id(), payload, compressed);
+                std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+                if(status == SFProtocol::OK)
+                    status = client.request(SFProtocol::DECOMPRESS, model.id(), compressed, decompressed);
+                std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+                if(status != SFProtocol::OK || decompressed != payload)
+                {
+                    failed = true;
+                    return;
+                }
+                compressed_bytes += compressed.size();
+                compress_nsecs[c].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+                decompress_nsecs[c].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count());
+            }
+        }));
+    }
+    for(std::thread& thread:threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    done = true;
+    if(swapper.joinable())
+        swapper.join();
+
+    if(failed)
+    {
+        std::cerr << "sfc: a request to " << p_args.at(0).toStdString() << " failed" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::setw(12) << "operation" << std::setw(10) << "requests" << std::setw(10) << "p50 us" << std::setw(10) << "p99 us" << std::endl
+              << std::fixed << std::setprecision(1);
+    for(int op = 0; op < 2; op++)
+    {
+        std::vector<qint64> all;
+        for(const std::vector<qint64>& nsecs:(op == 0 ? compress_nsecs : decompress_nsecs))
+            all.insert(all.end(), nsecs.begin(), nsecs.end());
+        std::sort(all.begin(), all.end());
+        std::cout << std::setw(12) << (op == 0 ? "compress" : "decompress") << std::setw(10) << all.size()
+                  << std::setw(10) << percentile(all, 50) << std::setw(10) << percentile(all, 99) << std::endl;
+    }
+    std::cout << connections << " connections, " << 2*qint64(requests) << " requests in " << std::setprecision(2) << seconds << " s: "
+              << std::setprecision(0) << 2*requests/seconds << " requests/s, ratio " << std::setprecision(3)
+              << double(compressed_bytes)/(double(requests)*payload_size) << std::endl;
+    if(swap_msecs > 0)
+        std::cout << swaps << " models trained and swapped in during the run" << std::endl;
+    return 0;
+}
+
+static int model(QStringList p_args)
+{
+    if(p_args.size() != 3)
+        return usage();
+
+    SFClient client;
+    if(!client.connect(p_args.at(0)))
+    {
+        std::cerr << "sfc: can not connect to " << p_args.at(0).toStdString() << std::endl;
+        return 1;
+    }
+
+    QByteArray payload, response;
+    int status = -1;
+    if(p_args.at(1) == "load")
+    {
+        status = client.request(SFProtocol::LOAD_MODEL, 0, p_args.at(2).toLocal8Bit(), response);
+    }
+    else if(p_args.at(1) == "train")
+    {
+        QFile file(p_args.at(2));
+        if(!file.open(QIODevice::ReadOnly))
+        {
+            std::cerr << "sfc: can not read " << p_args.at(2).toStdString() << std::endl;
+            return 1;
+        }
+        status = client.request(SFProtocol::TRAIN_MODEL, 0, file.readAll(), response);
+    }
+    else if(p_args.at(1) == "drop")
+    {
+        bool ok = false;
+        quint32 id = p_args.at(2).toUInt(&ok);
+        if(!ok)
+            return usage();
+        status = client.request(SFProtocol::DROP_MODEL, id, QByteArray(), response);
+    }
+    else
+    {
+        return usage();
+    }
+
+    if(status != SFProtocol::OK)
+    {
+        std::cerr << "sfc: the server answered with status " << status << std::endl;
+        return 1;
+    }
+    if(response.size() == 4)
+        std::cout << qFromBigEndian<quint32>(response.constData()) << std::endl;
+    return 0;
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QStringList args = a.arguments();
+    args.removeFirst();
+
+    if(args.isEmpty())
+        return usage();
+
+    QString command = args.takeFirst();
+    if(command == "train")
+        return train(args);
+    if(command == "compress")
+        return compress(args);
+    if(command == "compress-dir")
+        return compressDir(args);
+    if(command == "decompress")
+        return decompress(args);
+    if(command == "extract")
+        return extract(args);
+    if(command == "bench")
+        return bench(args);
+#ifdef Q_OS_UNIX
+    if(command == "serve")
+        return serve(args);
+    if(command == "loadgen")
+        return loadgen(args);
+    if(command == "model")
+        return model(args);
+#endif
+    return usage();
+}
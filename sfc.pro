@@ -0,0 +1,25 @@
+#-------------------------------------------------
+#
+# Command line tool of the Shannon Fano codec
+# build with: qmake sfc.pro -o Makefile.sfc && make -f Makefile.sfc
+#
+#-------------------------------------------------
+
+QT       += core
+QT       -= gui
+
+TARGET = sfc
+CONFIG   += console
+CONFIG   -= app_bundle
+TEMPLATE = app
+
+QMAKE_CXXFLAGS += -std=c++14
+
+SOURCES += sfc.cpp
+
+unix {
+    SOURCES += sfserver.cpp
+    HEADERS += sfserver.h
+}
+
+include(sfcore.pri)
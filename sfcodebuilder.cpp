@@ -0,0 +1,254 @@
+#include "sfcodebuilder.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+SFCodeBuilder::~SFCodeBuilder()
+{
+
+}
+
+/**
+ * @brief SFCodeBuilder::shannonFano returns the default builder
+ */
+const SFCodeBuilder& SFCodeBuilder::shannonFano()
+{
+    static const SFShannonFanoBuilder builder;
+    return builder;
+}
+
+/**
+ * @brief SFCodeBuilder::huffman returns the builder of the shortest codes
+ *
+ * Its codes stay below 64 bits for every histogram with less than 2^44 counts (a code of length n
+ * needs a total count of at least the n+2th Fibonacci number), see SFCodeTable::fromHistogram().
+ */
+const SFCodeBuilder& SFCodeBuilder::huffman()
+{
+    static const SFHuffmanBuilder builder;
+    return builder;
+}
+
+/**
+ * @brief SFCodeBuilder::builders returns one instance of every available builder
+ */
+QList<const SFCodeBuilder*> SFCodeBuilder::builders()
+{
+    static const SFFanoBuilder fano;
+
+    QList<const SFCodeBuilder*> result;
+    result << &shannonFano() << &fano << &huffman();
+    return result;
+}
+
+/**
+ * @brief SFCodeBuilder::fromName finds a builder by its name
+ * @return the builder or 0 if there is no builder with that name
+ */
+const SFCodeBuilder* SFCodeBuilder::fromName(const QString& p_name)
+{
+    for(const SFCodeBuilder* builder:builders())
+    {
+        if(builder->name() == p_name)
+            return builder;
+    }
+    return 0;
+}
+
+/**
+ * @brief SFCodeBuilder::splitByCode finds the split of a node in a list sorted by code
+ * @param it1 SFList::iterator to the first symbol of the node
+ * @param it2 SFList::iterator behind the last symbol of the node
+ * @param p_depth distance of the node to the root
+ * @return SFList::iterator to the first symbol whose code has a '1' at position p_depth
+ *
+ * All symbols of a node share the first p_depth bits of their codes so this is the point
+ * where the builder split the node, regardless of how the builder works.
+ */
+SFList::iterator SFCodeBuilder::splitByCode(const SFList::iterator it1, const SFList::iterator it2, int p_depth)
+{
+    return std::find_if(it1, it2, [p_depth](const Symbol& sym){return sym.getCode().at(p_depth) == '1';});
+}
+
+
+/**
+ * @brief SFShannonFanoBuilder::build assigns the codes with SFList::assignCodes()
+ */
+void SFShannonFanoBuilder::build(SFList& p_index) const
+{
+    SFList::assignCodes(p_index.begin(), p_index.end());
+}
+
+
+/**
+ * @brief SFFanoBuilder::build assigns the codes by recursivly partitioning the list
+ */
+void SFFanoBuilder::build(SFList& p_index) const
+{
+    if(p_index.size() == 1)
+        p_index.first().appendCode("0");
+    else if(p_index.size() > 1)
+        buildHelper(p_index.begin(), p_index.end());
+}
+
+/**
+ * @brief SFFanoBuilder::buildHelper splits [it1,it2) into the two sets with the smallest difference
+ *
+ * 1.) find the reachable sums of all subsets (reachable[i] holds the sums of subsets of the first i symbols)
+ * 2.) pick the reachable sum closest to half of the total and trace back which symbols form it
+ * 3.) move the set containing the first symbol to the front (both keep their order), append '0' and '1'
+ * 4.) call this function recursivly for both sets
+ * Lists that are to long for the subset sum (more than SUBSET_LIMIT symbols) are split by SFList::split().
+ */
+void SFFanoBuilder::buildHelper(const SFList::iterator it1, const SFList::iterator it2) const
+{
+    if(std::distance(it1, it2) > SUBSET_LIMIT)
+    {
+        SFList::iterator mid = SFList::split(it1, it2);
+        std::for_each(it1, mid, [](Symbol& sym){sym.appendCode("0");});
+        std::for_each(mid, it2, [](Symbol& sym){sym.appendCode("1");});
+        buildHelper(it1, mid);
+        buildHelper(mid, it2);
+        return;
+    }
+
+    std::vector<Symbol> symbols(it1, it2);
+    int size = int(symbols.size());
+    if(size < 2)
+        return;
+
+    qint64 total = 0;
+    for(const Symbol& sym:symbols)
+        total += sym.getCount();
+    qint64 scale = (total + COUNT_LIMIT - 1)/COUNT_LIMIT;
+
+    std::vector<int> counts(size);
+    int sum = 0;
+    for(int i = 0; i < size; i++)
+    {
+        counts[i] = int(std::max<qint64>(symbols[i].getCount()/scale, 1));
+        sum += counts[i];
+    }
+
+    int words = sum/64 + 1;                                                             //(1)
+    std::vector<quint64> reachable((size+1)*words, 0);
+    reachable[0] = 1;
+    for(int i = 1; i <= size; i++)
+    {
+        const quint64* prev = &reachable[(i-1)*words];
+        quint64* cur = &reachable[i*words];
+        int word_shift = counts[i-1]/64, bit_shift = counts[i-1]%64;
+
+        for(int w = 0; w < words; w++)
+        {
+            quint64 shifted = 0;
+            if(w - word_shift >= 0)
+                shifted = prev[w - word_shift] << bit_shift;
+            if(bit_shift && w - word_shift - 1 >= 0)
+                shifted |= prev[w - word_shift - 1] >> (64 - bit_shift);
+            cur[w] = prev[w] | shifted;
+        }
+    }
+
+    auto isReachable = [&](int p_row, int p_sum){return (reachable[p_row*words + p_sum/64] >> (p_sum%64)) & 1;};
+
+    int best = -1;                                                                      //(2)
+    for(int s = 1; s < sum; s++)
+    {
+        if(isReachable(size, s) && (best < 0 || std::abs(2*s - sum) < std::abs(2*best - sum)))
+            best = s;
+    }
+
+    std::vector<bool> in_subset(size, false);
+    for(int i = size, s = best; i > 0; i--)
+    {
+        if(!isReachable(i-1, s))
+        {
+            in_subset[i-1] = true;
+            s -= counts[i-1];
+        }
+    }
+
+    bool first_side = in_subset[0];                                                     //(3)
+    SFList::iterator mid = it1;
+    for(int i = 0; i < size; i++)
+    {
+        if(in_subset[i] == first_side)
+            *mid++ = symbols[i];
+    }
+    SFList::iterator iter = mid;
+    for(int i = 0; i < size; i++)
+    {
+        if(in_subset[i] != first_side)
+            *iter++ = symbols[i];
+    }
+
+    std::for_each(it1, mid, [](Symbol& sym){sym.appendCode("0");});
+    std::for_each(mid, it2, [](Symbol& sym){sym.appendCode("1");});
+
+    if(std::distance(it1, mid) > 1)                                                     //(4)
+        buildHelper(it1, mid);
+    if(std::distance(mid, it2) > 1)
+        buildHelper(mid, it2);
+}
+
+
+/**
+ * @brief SFHuffmanBuilder::build builds a Huffman tree to get the code lengths and assigns canonical codes
+ */
+void SFHuffmanBuilder::build(SFList& p_index) const
+{
+    int size = p_index.size();
+    if(size == 1)
+        p_index.first().appendCode("0");
+    if(size < 2)
+        return;
+
+    typedef std::pair<qint64, int> Node;        //weight and node id (ties are resolved by id)
+    std::priority_queue<Node, std::vector<Node>, std::greater<Node> > queue;
+    std::vector<int> parent(2*size - 1, -1);
+
+    for(int i = 0; i < size; i++)
+        queue.push(Node(std::max(p_index.at(i).getCount(), 1), i));
+
+    for(int next = size; queue.size() > 1; next++)  //merge the two lightest nodes
+    {
+        Node a = queue.top();
+        queue.pop();
+        Node b = queue.top();
+        queue.pop();
+        parent[a.second] = next;
+        parent[b.second] = next;
+        queue.push(Node(a.first + b.first, next));
+    }
+
+    std::vector<int> depth(2*size - 1, 0);          //parents are created after their children
+    for(int node = 2*size - 3; node >= 0; node--)   //so walking backwards visits parents first
+        depth[node] = depth[parent[node]] + 1;
+
+    std::vector<int> order(size);
+    for(int i = 0; i < size; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&depth](int a, int b){return depth[a] < depth[b];});
+
+    SFList result;
+    quint64 code = 0;
+    for(int i = 0; i < size; i++)
+    {
+        int length = depth[order[i]];
+        if(i > 0)
+            code = (code + 1) << (length - depth[order[i-1]]);
+
+        Symbol sym = p_index.at(order[i]);
+        QString bits;
+        for(int bit = length-1; bit >= 0; bit--)
+            bits.append((code >> bit) & 1 ? '1' : '0');
+        sym.setCode(bits);
+        result.append(sym);
+    }
+    p_index = result;
+}
@@ -0,0 +1,83 @@
+#ifndef SFCODEBUILDER_H
+#define SFCODEBUILDER_H
+
+#include <QList>
+#include <QString>
+
+#include "sflist.h"
+
+/**
+ * \class SFCodeBuilder
+ * @brief Interface of the algorithms that assign codes to the symbols of a SFList
+ *
+ * build() gets a list sorted from highest to lowest count whose codes are empty. Builders
+ * only use the integer counts, the probabilities are for display.
+ * It assigns a prefix code to every symbol and may reorder the list, but afterwards the
+ * list has to be sorted by the codes (the order of the leafs in the code tree from left
+ * to right). SFCodeTable::write() and the tree view rely on that order.
+ *
+ * The builders are stateless, the instances returned by builders() can be shared.
+ */
+class SFCodeBuilder
+{
+public:
+    virtual ~SFCodeBuilder();
+
+    virtual QString name() const = 0;
+    virtual void build(SFList& p_index) const = 0;
+
+    static const SFCodeBuilder& shannonFano();
+    static const SFCodeBuilder& huffman();
+    static QList<const SFCodeBuilder*> builders();
+    static const SFCodeBuilder* fromName(const QString& p_name);
+
+    static SFList::iterator splitByCode(const SFList::iterator it1, const SFList::iterator it2, int p_depth);
+};
+
+/**
+ * \class SFShannonFanoBuilder
+ * @brief The heuristic split of SFList::split() (see SFList::assignCodes())
+ */
+class SFShannonFanoBuilder : public SFCodeBuilder
+{
+public:
+    QString name() const {return "shannon-fano";}
+    void build(SFList& p_index) const;
+};
+
+/**
+ * \class SFFanoBuilder
+ * @brief Splits every list into two sets whose counts are as close as possible
+ *
+ * In contrast to SFList::split() the two parts do not have to be contiguous ranges of the
+ * sorted list. The best partition is found with a subset sum over the counts (pseudo-polynomial).
+ * Ranges with a total count above COUNT_LIMIT are scaled down first and ranges with more than
+ * SUBSET_LIMIT symbols are split by the heuristic until they are small enough.
+ */
+class SFFanoBuilder : public SFCodeBuilder
+{
+public:
+    QString name() const {return "fano";}
+    void build(SFList& p_index) const;
+
+private:
+    static const int COUNT_LIMIT = 1 << 16;
+    static const int SUBSET_LIMIT = 1024;
+
+    void buildHelper(const SFList::iterator it1, const SFList::iterator it2) const;
+};
+
+/**
+ * \class SFHuffmanBuilder
+ * @brief Optimal prefix codes built bottom up in O(k log k)
+ *
+ * The codes are assigned canonically (shorter codes first) so the list stays sorted by code.
+ */
+class SFHuffmanBuilder : public SFCodeBuilder
+{
+public:
+    QString name() const {return "huffman";}
+    void build(SFList& p_index) const;
+};
+
+#endif // SFCODEBUILDER_H
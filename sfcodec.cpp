@@ -2,6 +2,7 @@
 
 SFCodec::SFCodec(QTextEdit* p_inputField) :
     index(),
+    builder(&SFCodeBuilder::shannonFano()),
     outputText(),
     outputBin()
 {
@@ -14,9 +15,9 @@ SFCodec::SFCodec(QTextEdit* p_inputField) :
 
 /**
  * @brief SFCodec::encode encodes the input text
- * @return QString of the encoded input text
+ * @return QString of the encoded input text (valid until the next call)
  */
-QString SFCodec::encode()
+const QString& SFCodec::encode()
 {
     outputText.clear();
     int i = -1;
@@ -32,9 +33,9 @@ QString SFCodec::encode()
     //the list has to be sorted from highest to lowest probability
 /**
  * @brief SFCodec::toBin gives a binary representation of the input text
- * @return QString of the binary representation
+ * @return QString of the binary representation (valid until the next call)
  */
-QString SFCodec::toBin()
+const QString& SFCodec::toBin()
 {
     outputBin.clear();
     std::bitset<8> bitset;
@@ -52,8 +53,8 @@ QString SFCodec::toBin()
 /**
  * @brief SFCodec::updateIndex updates the index
  *
- * Call this whenever the input text is changed.
- * This updates the index.
+ * Call this whenever the input text or the builder is changed.
+ * This updates the index. The codes are assigned by the current SFCodeBuilder.
  */
 void SFCodec::updateIndex()
 {
@@ -81,33 +82,8 @@ void SFCodec::updateIndex()
     for(auto &sym:index)
         sym.setProb((double)sym.getCount()/(double)inputText.length());
 
-    qSort(index.begin(),index.end()); //the list has to be sorted from highest to lowest probability
-    updateIndexHelper(index.begin(), index.end());
-}
-
-/**
- * @brief SFCodec::updateIndexHelper creates the codes by recursivly calling itself
- * @param it1 SFList::iterator to the first relevant Symbol
- * @param it2 SFList::iterator to the address behind the last releveant Symbol
- * The SFList between the iterators has to be sorted!!!
- * This function calculates and adds a code to each character:
- * 1.) devide the vector into two vectors with equal probability
- * 2.) add a zero to the left and a one to the right vector
- * 3.) call this function recursivly for both parts of the list
- */
-void SFCodec::updateIndexHelper(const SFList::iterator it1, const SFList::iterator it2)
-{
-    SFList::iterator mid = SFList::split(it1, it2);                     //(1)
-
-    if(it1 != mid)
-        std::for_each(it1, mid, [](Symbol& sym){sym.appendCode("0");}); //(2)
-    if(it2 != mid)
-        std::for_each(mid, it2, [](Symbol& sym){sym.appendCode("1");});
-
-    if(std::distance(it1, mid) > 1)                                     //(3)
-        updateIndexHelper(it1, mid);
-    if(std::distance(mid, it2) > 1)
-        updateIndexHelper(mid, it2);
+    index.sortByCount(); //the list has to be sorted from highest to lowest count
+    builder->build(index);
 }
 
 /**
@@ -22,6 +22,7 @@
 #include <cassert>
 
 #include "sflist.h"
+#include "sfcodebuilder.h"
 #include "sftreenode.h"
 
 
@@ -42,11 +43,15 @@ class SFCodec
 public:
     explicit SFCodec(QTextEdit* p_inputField = 0);
 
-    QString encode();
-    QString toBin();
+    const QString& encode();
+    const QString& toBin();
 
     void updateIndex(); //calculate the code
-    SFList getIndex(){return index;}
+    const SFList& getIndex() const {return index;}
+    void setIndex(const SFList& p_index) {index = p_index;}    //index of a file, see SFFileAnalyzer
+
+    void setBuilder(const SFCodeBuilder* p_builder) {builder = p_builder;}
+    const SFCodeBuilder* getBuilder() const {return builder;}
 
 
     void updateTable(QTableWidget* table) const; //erneuert die informationen in der tabelle
@@ -54,9 +59,8 @@ public:
 
 
 private:
-    void updateIndexHelper(const SFList::iterator it1, const SFList::iterator it2);
-
     SFList index;
+    const SFCodeBuilder* builder;
     QString inputText;
     QTextEdit* inputField;
     QString outputText;
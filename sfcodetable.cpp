@@ -0,0 +1,365 @@
+#include "sfcodetable.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+const quint64 SFCodeTable::NO_CODE;
+const int SFCodeTable::LOOKUP_BITS;
+
+SFCodeTable::SFCodeTable(int p_alphabet_size):
+    m_codes(p_alphabet_size*int(sizeof(SFCode)), '\0'),
+    m_order(),
+    m_tree()
+{
+
+}
+
+/**
+ * @brief SFCodeTable::fromIndex converts the codes of a SFList into a SFCodeTable
+ * @param p_index SFList whose symbols already got their codes (see SFList::assignCodes())
+ * @param p_alphabet_size number of possible symbols. Every symbol in p_index has to be smaller
+ * @return SFCodeTable containing the codes of p_index or an empty table if a code is longer than
+ * 64 bits (see SFList::appendBit()), such codes can not be encoded
+ */
+SFCodeTable SFCodeTable::fromIndex(const SFList& p_index, int p_alphabet_size)
+{
+    SFCodeTable table(p_alphabet_size);
+
+    for(const Symbol& sym:p_index)
+    {
+        if(sym.getCode().length() > 64)
+            return SFCodeTable(p_alphabet_size);
+
+        SFCode code{0, 0};
+        for(const QChar bit:sym.getCode())
+        {
+            code.bits = (code.bits << 1) | quint64(bit == '1');
+            code.length++;
+        }
+        table.insert(sym.getSym().unicode(), code);
+    }
+    return table;
+}
+
+/**
+ * @brief SFCodeTable::fromRawData creates a table that uses external memory without copying it
+ *
+ * The memory has to stay valid as long as the table or a copy of it exists.
+ * @param p_codes array of p_alphabet_size SFCode entries
+ * @param p_order array of p_order_size qint32 symbols in the order of their codes
+ * @param p_tree array of p_tree_size qint32 decode tree nodes
+ */
+SFCodeTable SFCodeTable::fromRawData(const char* p_codes, int p_alphabet_size, const char* p_order, int p_order_size,
+                                     const char* p_tree, int p_tree_size)
+{
+    SFCodeTable table(0);
+    table.m_codes = QByteArray::fromRawData(p_codes, p_alphabet_size*int(sizeof(SFCode)));
+    table.m_order = QByteArray::fromRawData(p_order, p_order_size*int(sizeof(qint32)));
+    table.m_tree = QByteArray::fromRawData(p_tree, p_tree_size*int(sizeof(qint32)));
+    table.buildLookup();
+    return table;
+}
+
+/**
+ * @brief SFCodeTable::fromHistogram builds the codes for a histogram of byte values
+ * @param p_histogram number of occurences of every symbol (index = symbol)
+ * @param p_builder the algorithm that assigns the codes
+ * @return SFCodeTable with a code for every symbol that occurs at least once
+ *
+ * If p_builder assigns a code longer than 64 bits the table is built by the Huffman builder instead,
+ * whose codes are shorter for the scaled down counts of indexOfHistogram() (see SFCodeBuilder::huffman()).
+ * The tables are stored with their codes, so decoders do not depend on the builder.
+ */
+SFCodeTable SFCodeTable::fromHistogram(const QVector<quint64>& p_histogram, const SFCodeBuilder& p_builder)
+{
+    SFList index = indexOfHistogram(p_histogram, p_builder);
+    SFCodeTable table = fromIndex(index, p_histogram.size());
+    if(table.isEmpty() && !index.isEmpty() && &p_builder != &SFCodeBuilder::huffman())
+        table = fromIndex(indexOfHistogram(p_histogram, SFCodeBuilder::huffman()), p_histogram.size());
+    return table;
+}
+
+/**
+ * @brief SFCodeTable::indexOfHistogram builds the SFList with the codes of a histogram
+ * @param p_histogram number of occurences of every symbol (index = symbol)
+ * @param p_builder the algorithm that assigns the codes
+ * @return the symbols that occur at least once, sorted by the codes like SFCodec::getIndex()
+ *
+ * This is what fromHistogram() builds its table from. The GUI uses it to show the codes of a file.
+ */
+SFList SFCodeTable::indexOfHistogram(const QVector<quint64>& p_histogram, const SFCodeBuilder& p_builder)
+{
+    quint64 total = 0;
+    for(quint64 count:p_histogram)
+        total += count;
+
+    quint64 divisor = 1;                                        //Symbol stores an int count so huge
+    while(total/divisor > quint64(std::numeric_limits<int>::max()))  //histograms are scaled down
+        divisor *= 2;
+
+    SFList index;
+    for(int i = 0; i < p_histogram.size(); i++)
+    {
+        if(p_histogram.at(i) > 0)
+        {
+            index.append(Symbol(QChar(ushort(i))));
+            index.last().setCount(int(std::max<quint64>(p_histogram.at(i)/divisor, 1)));
+            index.last().setProb(double(p_histogram.at(i))/double(total));
+        }
+    }
+
+    index.sortByCount(); //the list has to be sorted from highest to lowest count
+    p_builder.build(index);
+    return index;
+}
+
+/**
+ * @brief SFCodeTable::withLookup returns a copy that also has the lookup table for decoding
+ *
+ * Tables built from a histogram only get the decode tree. Decoders that use such a table
+ * many times (see SFServer) build the lookup table once with this function.
+ */
+SFCodeTable SFCodeTable::withLookup() const
+{
+    SFCodeTable table = *this;
+    if(table.m_lookup.isEmpty())
+        table.buildLookup();
+    return table;
+}
+
+/**
+ * @brief SFCodeTable::histogram counts the occurences of every byte value
+ * @param p_data pointer to the first byte
+ * @param p_size number of bytes
+ * @param p_alphabet_size size of the resulting histogram
+ * @return vector with the number of occurences of every byte value
+ */
+QVector<quint64> SFCodeTable::histogram(const char* p_data, qint64 p_size, int p_alphabet_size)
+{
+    QVector<quint64> result(p_alphabet_size, 0);
+    const uchar* data = reinterpret_cast<const uchar*>(p_data);
+
+    for(qint64 i = 0; i < p_size; i++)
+        result[data[i]]++;
+    return result;
+}
+
+/**
+ * @brief SFCodeTable::cost calculates the size of the encoded data without encoding it
+ * @param p_histogram number of occurences of every symbol
+ * @return sum of count*length over all symbols in bits or NO_CODE if a symbol in p_histogram has no code
+ */
+quint64 SFCodeTable::cost(const QVector<quint64>& p_histogram) const
+{
+    quint64 result = 0;
+    for(int i = 0; i < p_histogram.size(); i++)
+    {
+        if(p_histogram.at(i) == 0)
+            continue;
+        if(i >= alphabetSize() || codes()[i].length == 0)
+            return NO_CODE;
+        result += p_histogram.at(i)*quint64(codes()[i].length);
+    }
+    return result;
+}
+
+/**
+ * @brief SFCodeTable::entropyBound calculates the minimal size of the encoded data in bits
+ *
+ * No prefix code can encode the data in less bits than its entropy so this is a lower bound
+ * for cost() of every table that could be built for p_histogram.
+ */
+double SFCodeTable::entropyBound(const QVector<quint64>& p_histogram)
+{
+    double total = 0;
+    for(quint64 count:p_histogram)
+        total += count;
+
+    double result = 0;
+    for(quint64 count:p_histogram)
+    {
+        if(count > 0)
+            result += count*std::log2(total/count);
+    }
+    return result;
+}
+
+/**
+ * @brief SFCodeTable::write serializes the table
+ *
+ * Only the symbols in the order of their codes and the code lengths are written. Since every
+ * SFCodeBuilder leaves the list sorted by code the codes can be reconstructed from this
+ * information (see SFCodeTable::read()).
+ */
+void SFCodeTable::write(SFBitWriter& p_writer) const
+{
+    int symbol_bits = symbolBits(alphabetSize());
+
+    p_writer.writeBits(orderSize(), 16);
+    for(int i = 0; i < orderSize(); i++)
+    {
+        p_writer.writeBits(order()[i], symbol_bits);
+        p_writer.writeBits(codes()[order()[i]].length - 1, 6);
+    }
+}
+
+/**
+ * @brief SFCodeTable::read reads a table that was serialized by SFCodeTable::write()
+ * @param p_reader SFBitReader positioned at the start of the table
+ * @param p_alphabet_size has to be the same as the one of the written table
+ * @return the table or an empty table if the data is corrupted
+ */
+SFCodeTable SFCodeTable::read(SFBitReader& p_reader, int p_alphabet_size)
+{
+    SFCodeTable table(p_alphabet_size);
+    int symbol_bits = symbolBits(p_alphabet_size);
+    int size = int(p_reader.readBits(16));
+
+    SFCode code{0, 0};
+    for(int i = 0; i < size; i++)
+    {
+        int sym = int(p_reader.readBits(symbol_bits));
+        int length = int(p_reader.readBits(6)) + 1;
+
+        if(sym >= p_alphabet_size || table.code(sym).length != 0)
+            return SFCodeTable(p_alphabet_size);
+
+        if(i > 0)                   //the next leaf to the right of the previous one
+        {
+            code.bits++;
+            if(length > code.length)
+                code.bits <<= length - code.length;
+            else
+                code.bits >>= code.length - length;
+        }
+        code.length = length;
+        table.insert(sym, code);
+    }
+    table.buildLookup();
+    return table;
+}
+
+/**
+ * @brief SFCodeTable::serializedBits size of a serialized table without building it
+ * @param p_symbols number of symbols with a code
+ * @param p_alphabet_size size of the alphabet
+ * @return number of bits SFCodeTable::write() writes
+ */
+int SFCodeTable::serializedBits(int p_symbols, int p_alphabet_size)
+{
+    return 16 + p_symbols*(symbolBits(p_alphabet_size) + 6);
+}
+
+/**
+ * @brief SFCodeTable::decodeTree reads the rest of a code bit by bit walking the decode tree
+ * @param p_reader SFBitReader positioned behind the bits that lead to p_node
+ * @param p_node inner node of the decode tree
+ * @return the decoded symbol or -1 if the reader ran out of bits or the code is unknown
+ */
+int SFCodeTable::decodeTree(SFBitReader& p_reader, int p_node) const
+{
+    if(m_tree.isEmpty())
+        return -1;
+
+    int node = p_node;
+    while(!isLeaf(node))
+    {
+        int bit = p_reader.readBit();
+        if(bit < 0)
+            return -1;
+        node = child(node, bit);
+        if(node == root())      //the table is not complete and this code does not exist
+            return -1;
+    }
+    return leafSymbol(node);
+}
+
+/**
+ * @brief SFCodeTable::insert adds p_code for p_symbol to the code array and to the decode tree
+ */
+void SFCodeTable::insert(int p_symbol, const SFCode& p_code)
+{
+    Q_ASSERT(p_symbol >= 0 && p_symbol < alphabetSize());
+    Q_ASSERT(p_code.length > 0 && p_code.length <= 64);
+
+    SFCode& entry = reinterpret_cast<SFCode*>(m_codes.data())[p_symbol];
+    entry.bits = p_code.bits;
+    entry.length = p_code.length;
+    m_order.append(reinterpret_cast<const char*>(&p_symbol), sizeof(qint32));
+
+    if(m_tree.isEmpty())
+        m_tree.fill('\0', 2*int(sizeof(qint32)));     //the root
+
+    int node = root();
+    for(int i = p_code.length-1; i >= 0; i--)
+    {
+        qint32* nodes = reinterpret_cast<qint32*>(m_tree.data());
+        int slot = 2*node + int((p_code.bits >> i) & 1);
+        if(i == 0)
+        {
+            nodes[slot] = ~p_symbol;
+        }
+        else
+        {
+            if(nodes[slot] <= 0)    //no inner node yet
+            {
+                nodes[slot] = treeSize()/2;
+                m_tree.append(QByteArray(2*int(sizeof(qint32)), '\0'));
+            }
+            node = tree()[slot];
+        }
+    }
+}
+
+/**
+ * @brief SFCodeTable::buildLookup fills the lookup table used by SFCodeTable::decode()
+ */
+void SFCodeTable::buildLookup()
+{
+    m_lookup.fill(0, 1 << LOOKUP_BITS);
+    if(!m_tree.isEmpty())
+        fillLookup(root(), 0, 0);
+}
+
+/**
+ * @brief SFCodeTable::fillLookup fills the entries of all bit patterns that start with the path to p_node
+ * @param p_node inner node of the decode tree
+ * @param p_depth length of the path to p_node
+ * @param p_prefix the path to p_node (right aligned)
+ */
+void SFCodeTable::fillLookup(int p_node, int p_depth, int p_prefix)
+{
+    if(p_depth == LOOKUP_BITS)
+    {
+        m_lookup[p_prefix] = quint32(p_node) << 8;
+        return;
+    }
+
+    for(int bit = 0; bit < 2; bit++)
+    {
+        int node = child(p_node, bit);
+        int prefix = (p_prefix << 1) | bit;
+        if(isLeaf(node))                    //every pattern that starts with this code decodes to the leaf
+        {
+            int free_bits = LOOKUP_BITS - p_depth - 1;
+            quint32 entry = (quint32(leafSymbol(node)) << 8) | quint32(p_depth + 1);
+            std::fill(m_lookup.begin() + (prefix << free_bits), m_lookup.begin() + ((prefix + 1) << free_bits), entry);
+        }
+        else if(node != root())             //missing branches of incomplete tables stay 0
+        {
+            fillLookup(node, p_depth + 1, prefix);
+        }
+    }
+}
+
+/**
+ * @brief SFCodeTable::symbolBits number of bits needed to store a symbol of the alphabet
+ */
+int SFCodeTable::symbolBits(int p_alphabet_size)
+{
+    int bits = 1;
+    while((1 << bits) < p_alphabet_size)
+        bits++;
+    return bits;
+}
@@ -0,0 +1,117 @@
+#ifndef SFCODETABLE_H
+#define SFCODETABLE_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtGlobal>
+
+#include "sflist.h"
+#include "sfcodebuilder.h"
+#include "sfbitstream.h"
+
+/**
+ * @brief The SFCode struct holds the code of one symbol as integer (right aligned)
+ */
+struct SFCode
+{
+    quint64 bits;
+    int length;     //0 if the symbol has no code
+};
+
+/**
+ * \class SFCodeTable
+ * @brief Compact integer representation of the codes stored in a SFList
+ *
+ * SFList stores every code as QString of '0' and '1' which is fine for displaying it
+ * but to slow for encoding and decoding binary data. SFCodeTable maps every symbol
+ * (QChar::unicode() of the Symbol) to its code and holds a binary decode tree.
+ *
+ * All arrays are stored as plain memory in QByteArrays so a table can also be a view on
+ * memory it does not own (see SFCodeTable::fromRawData() and SFModel). Tables are never
+ * modified after they were built.
+ *
+ * Tables that are used for decoding (the ones created by read() and fromRawData()) also get
+ * a lookup table indexed by the next LOOKUP_BITS bits of the input. An entry holds the symbol
+ * and the code length if the code is not longer than LOOKUP_BITS, otherwise the node of the
+ * decode tree those bits lead to. Most symbols are decoded with one lookup.
+ */
+class SFCodeTable
+{
+public:
+    explicit SFCodeTable(int p_alphabet_size = 256);
+
+    static SFCodeTable fromIndex(const SFList& p_index, int p_alphabet_size = 256);
+    static SFCodeTable fromRawData(const char* p_codes, int p_alphabet_size, const char* p_order, int p_order_size,
+                                   const char* p_tree, int p_tree_size);
+    static SFCodeTable fromHistogram(const QVector<quint64>& p_histogram, const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+    static SFList indexOfHistogram(const QVector<quint64>& p_histogram, const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+    static QVector<quint64> histogram(const char* p_data, qint64 p_size, int p_alphabet_size = 256);
+    SFCodeTable withLookup() const;
+
+    static const quint64 NO_CODE = ~quint64(0);     //returned by cost() if a symbol has no code
+    static const int LOOKUP_BITS = 10;
+    quint64 cost(const QVector<quint64>& p_histogram) const;
+    static double entropyBound(const QVector<quint64>& p_histogram);
+
+    void write(SFBitWriter& p_writer) const;
+    static SFCodeTable read(SFBitReader& p_reader, int p_alphabet_size = 256);
+    int serializedBits() const {return serializedBits(orderSize(), alphabetSize());}
+    static int serializedBits(int p_symbols, int p_alphabet_size);
+
+    int alphabetSize() const {return m_codes.size()/int(sizeof(SFCode));}
+    const SFCode& code(int p_symbol) const {return codes()[p_symbol];}
+    bool isEmpty() const {return m_tree.isEmpty();}
+
+    void encode(SFBitWriter& p_writer, int p_symbol) const {p_writer.writeBits(codes()[p_symbol].bits, codes()[p_symbol].length);}
+    inline int decode(SFBitReader& p_reader) const;
+
+    static int root() {return 0;}
+    int child(int p_node, int p_bit) const {return tree()[2*p_node + p_bit];}   //returns a node index (> 0) or ~symbol (< 0) for leafs
+    static bool isLeaf(int p_node) {return p_node < 0;}
+    static int leafSymbol(int p_node) {return ~p_node;}
+
+    const SFCode* codes() const {return reinterpret_cast<const SFCode*>(m_codes.constData());}
+    const qint32* order() const {return reinterpret_cast<const qint32*>(m_order.constData());}
+    const qint32* tree() const {return reinterpret_cast<const qint32*>(m_tree.constData());}
+    int orderSize() const {return m_order.size()/int(sizeof(qint32));}
+    int treeSize() const {return m_tree.size()/int(sizeof(qint32));}
+
+private:
+    void insert(int p_symbol, const SFCode& p_code);
+    void buildLookup();
+    void fillLookup(int p_node, int p_depth, int p_prefix);
+    int decodeTree(SFBitReader& p_reader, int p_node) const;
+
+    static int symbolBits(int p_alphabet_size);
+
+    QByteArray m_codes;         //one SFCode per symbol
+    QByteArray m_order;         //qint32 symbols in the order of their codes (left to right in the code tree)
+    QByteArray m_tree;          //qint32 nodes, two entries (bit 0 and bit 1) per inner node
+    QVector<quint32> m_lookup;  //(symbol << 8 | length) or (node << 8) for longer codes, 0 for invalid codes
+};
+
+/**
+ * @brief SFCodeTable::decode reads one code from p_reader
+ * @param p_reader SFBitReader positioned at the start of a code
+ * @return the decoded symbol or -1 if the reader ran out of bits or the code is unknown
+ */
+inline int SFCodeTable::decode(SFBitReader& p_reader) const
+{
+    if(m_lookup.isEmpty())
+        return decodeTree(p_reader, root());
+
+    quint32 entry = m_lookup.constData()[p_reader.peekBits(LOOKUP_BITS)];
+    int length = int(entry & 0xFF);
+    if(length > 0 && length <= p_reader.bitsLeft())
+    {
+        p_reader.skipBits(length);
+        return int(entry >> 8);
+    }
+    if(length > 0 || entry == 0 || p_reader.bitsLeft() < LOOKUP_BITS)
+        return -1;
+
+    p_reader.skipBits(LOOKUP_BITS);     //code is longer than LOOKUP_BITS, continue in the tree
+    return decodeTree(p_reader, int(entry >> 8));
+}
+
+#endif // SFCODETABLE_H
@@ -0,0 +1,213 @@
+#include "sfcontexttable.h"
+
+SFContextTable::SFContextTable():
+    m_buckets(0),
+    m_tables(),
+    m_rows(),
+    m_table_of(),
+    m_entries()
+{
+
+}
+
+/**
+ * @brief SFContextTable::fromData builds the tables for all contexts that occur in p_data
+ * @param p_data pointer to the first byte. The context of the first byte is 0
+ * @param p_size number of bytes
+ * @param p_buckets number of context buckets (power of two, 1-256)
+ * @param p_builder the algorithm that assigns the codes
+ * @return the context tables
+ */
+SFContextTable SFContextTable::fromData(const char* p_data, int p_size, int p_buckets, const SFCodeBuilder& p_builder)
+{
+    Q_ASSERT(p_buckets > 0 && p_buckets <= MAX_BUCKETS && (p_buckets & (p_buckets-1)) == 0);
+
+    const uchar* data = reinterpret_cast<const uchar*>(p_data);
+    QVector<quint64> histograms(p_buckets*256, 0);
+    uchar context = 0;
+    for(int i = 0; i < p_size; i++)
+    {
+        histograms[bucket(context, p_buckets)*256 + data[i]]++;
+        context = data[i];
+    }
+
+    SFContextTable result;
+    result.m_buckets = p_buckets;
+    result.m_tables.resize(p_buckets);
+    for(int b = 0; b < p_buckets; b++)
+    {
+        QVector<quint64> histogram = histograms.mid(b*256, 256);
+        quint64 total = 0;
+        for(quint64 count:histogram)
+            total += count;
+
+        result.m_tables[b] = total ? SFCodeTable::fromHistogram(histogram, p_builder) : SFCodeTable(0);
+    }
+    result.index();
+    return result;
+}
+
+/**
+ * @brief SFContextTable::bucket maps a context to its bucket
+ *
+ * The byte value is scrambled by a permutation (xorshift and multiplication with an odd number)
+ * before the lower bits are taken, so contexts that only differ in their upper bits do not always
+ * share a bucket.
+ */
+int SFContextTable::bucket(uchar p_context, int p_buckets)
+{
+    uint hash = p_context;
+    hash ^= hash >> 4;
+    hash = (hash*0x9D) & 0xFF;
+    hash ^= hash >> 3;
+    return int(hash) & (p_buckets - 1);
+}
+
+/**
+ * @brief SFContextTable::cost calculates the size of p_data encoded with these tables
+ * @return size in bits (without the tables)
+ */
+quint64 SFContextTable::cost(const char* p_data, int p_size) const
+{
+    const uchar* data = reinterpret_cast<const uchar*>(p_data);
+    quint64 result = 0;
+    uchar context = 0;
+    for(int i = 0; i < p_size; i++)
+    {
+        result += m_entries.at(m_rows.at(context) + data[i]) & 0xFF;
+        context = data[i];
+    }
+    return result;
+}
+
+/**
+ * @brief SFContextTable::serializedBits number of bits SFContextTable::write() writes
+ */
+int SFContextTable::serializedBits() const
+{
+    int result = 9;
+    for(const SFCodeTable& table:m_tables)
+        result += 1 + (table.isEmpty() ? 0 : table.serializedBits());
+    return result;
+}
+
+/**
+ * @brief SFContextTable::write serializes the tables: the number of buckets (9 bits) and for
+ * every bucket a flag (1 bit) if it has a table followed by the table (see SFCodeTable::write())
+ */
+void SFContextTable::write(SFBitWriter& p_writer) const
+{
+    p_writer.writeBits(m_buckets, 9);
+    for(const SFCodeTable& table:m_tables)
+    {
+        p_writer.writeBits(table.isEmpty() ? 0 : 1, 1);
+        if(!table.isEmpty())
+            table.write(p_writer);
+    }
+}
+
+/**
+ * @brief SFContextTable::read reads tables written by SFContextTable::write()
+ * @return the tables or tables with 0 buckets if the data is corrupted
+ */
+SFContextTable SFContextTable::read(SFBitReader& p_reader)
+{
+    SFContextTable result;
+    int buckets = int(p_reader.readBits(9));
+    if(buckets == 0 || buckets > MAX_BUCKETS || (buckets & (buckets-1)) != 0)
+        return result;
+
+    result.m_tables.resize(buckets);
+    for(int b = 0; b < buckets; b++)
+    {
+        if(p_reader.readBit() == 1)
+        {
+            result.m_tables[b] = SFCodeTable::read(p_reader);
+            if(result.m_tables.at(b).isEmpty())
+                return SFContextTable();
+        }
+        else
+        {
+            result.m_tables[b] = SFCodeTable(0);
+        }
+    }
+    result.m_buckets = buckets;
+    result.index();
+    return result;
+}
+
+/**
+ * @brief SFContextTable::encode encodes p_data with the table of the respective context
+ */
+void SFContextTable::encode(SFBitWriter& p_writer, const char* p_data, int p_size) const
+{
+    const uchar* data = reinterpret_cast<const uchar*>(p_data);
+    const quint64* entries = m_entries.constData();
+    const int* rows = m_rows.constData();
+    uchar context = 0;
+
+    for(int i = 0; i < p_size; i++)
+    {
+        quint64 entry = entries[rows[context] + data[i]];
+        p_writer.writeBits(entry >> 8, int(entry & 0xFF));
+        context = data[i];
+    }
+}
+
+/**
+ * @brief SFContextTable::decode decodes p_size bytes
+ * @param p_reader SFBitReader positioned at the first code
+ * @param p_out buffer for at least p_size bytes
+ * @return false if the data is corrupted
+ */
+bool SFContextTable::decode(SFBitReader& p_reader, char* p_out, int p_size) const
+{
+    uchar context = 0;
+    for(int i = 0; i < p_size; i++)
+    {
+        int table = m_table_of.at(context);
+        if(table < 0)
+            return false;
+
+        int sym = m_tables.at(table).decode(p_reader);
+        if(sym < 0)
+            return false;
+        p_out[i] = char(sym);
+        context = uchar(sym);
+    }
+    return true;
+}
+
+/**
+ * @brief SFContextTable::index fills the lookup arrays after the tables were built or read
+ */
+void SFContextTable::index()
+{
+    m_rows.fill(-1, 256);
+    m_table_of.fill(-1, 256);
+    m_entries.clear();
+
+    QVector<int> row_of_bucket(m_buckets, -1);
+    for(int b = 0; b < m_buckets; b++)
+    {
+        const SFCodeTable& table = m_tables.at(b);
+        if(table.isEmpty())
+            continue;
+
+        row_of_bucket[b] = m_entries.size();
+        for(int sym = 0; sym < 256; sym++)
+        {
+            const SFCode& code = table.code(sym);
+            Q_ASSERT(code.length <= MAX_CODE_LENGTH);
+            m_entries.append((code.bits << 8) | quint64(code.length));
+        }
+    }
+
+    for(int context = 0; context < 256; context++)
+    {
+        int b = bucket(uchar(context), m_buckets);
+        m_rows[context] = row_of_bucket.at(b);
+        if(row_of_bucket.at(b) >= 0)
+            m_table_of[context] = b;
+    }
+}
@@ -0,0 +1,55 @@
+#ifndef SFCONTEXTTABLE_H
+#define SFCONTEXTTABLE_H
+
+#include <QVector>
+#include <QtGlobal>
+
+#include "sfcodetable.h"
+#include "sfbitstream.h"
+
+/**
+ * \class SFContextTable
+ * @brief Order-1 code tables: one code table per context bucket
+ *
+ * The previous byte (the context) is mapped to one of p_buckets buckets (a power of two up to 256)
+ * by a fixed permutation of the byte values, so with 256 buckets every context gets its own table
+ * and fewer buckets bound the memory and the size of the stored tables. Tables are only built
+ * for buckets that occur in the data.
+ *
+ * Encoding uses a two level lookup: m_rows maps the context to the first entry of its row in
+ * m_entries which holds one packed code (bits << 8 | length) per symbol, so a row of 256 codes
+ * occupies 2 KiB of contiguous memory. Decoding looks up the table of the context the same way
+ * and walks its decode tree.
+ */
+class SFContextTable
+{
+public:
+    enum {MAX_BUCKETS = 256, MAX_CODE_LENGTH = 56};
+
+    SFContextTable();
+
+    static SFContextTable fromData(const char* p_data, int p_size, int p_buckets,
+                                   const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+    static int bucket(uchar p_context, int p_buckets);
+
+    int buckets() const {return m_buckets;}
+    quint64 cost(const char* p_data, int p_size) const;
+    int serializedBits() const;
+
+    void write(SFBitWriter& p_writer) const;
+    static SFContextTable read(SFBitReader& p_reader);
+
+    void encode(SFBitWriter& p_writer, const char* p_data, int p_size) const;
+    bool decode(SFBitReader& p_reader, char* p_out, int p_size) const;
+
+private:
+    void index();
+
+    int m_buckets;
+    QVector<SFCodeTable> m_tables;  //one table per bucket (empty if the bucket does not occur)
+    QVector<int> m_rows;            //first level: context -> offset of its row in m_entries (or -1)
+    QVector<int> m_table_of;        //context -> index in m_tables
+    QVector<quint64> m_entries;     //second level: packed codes, 256 per used bucket
+};
+
+#endif // SFCONTEXTTABLE_H
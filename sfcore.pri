@@ -0,0 +1,42 @@
+# Codec sources shared by the GUI (Shannon-Fano-Kodierung.pro) and the command line tool (sfc.pro)
+
+SOURCES += \
+    $$PWD/symbol.cpp \
+    $$PWD/sflist.cpp \
+    $$PWD/sfcodebuilder.cpp \
+    $$PWD/sfbitstream.cpp \
+    $$PWD/sfcodetable.cpp \
+    $$PWD/sfadaptivecodec.cpp \
+    $$PWD/sfcontexttable.cpp \
+    $$PWD/sfblockcodec.cpp \
+    $$PWD/sfblockindex.cpp \
+    $$PWD/sfbatchcodec.cpp \
+    $$PWD/sftokencodec.cpp \
+    $$PWD/sfmodel.cpp \
+    $$PWD/sfpipeline.cpp \
+    $$PWD/sftaskpool.cpp \
+    $$PWD/sfdirectorycompressor.cpp \
+    $$PWD/sffileanalyzer.cpp \
+    $$PWD/sftelemetry.cpp
+
+HEADERS += \
+    $$PWD/symbol.h \
+    $$PWD/sflist.h \
+    $$PWD/sfcodebuilder.h \
+    $$PWD/sfbitstream.h \
+    $$PWD/sfcodetable.h \
+    $$PWD/sfadaptivecodec.h \
+    $$PWD/sfcontexttable.h \
+    $$PWD/sfblockcodec.h \
+    $$PWD/sfblockindex.h \
+    $$PWD/sfbatchcodec.h \
+    $$PWD/sftokencodec.h \
+    $$PWD/sfmodel.h \
+    $$PWD/sfboundedqueue.h \
+    $$PWD/sfepochpointer.h \
+    $$PWD/sfpipeline.h \
+    $$PWD/sftaskpool.h \
+    $$PWD/sfdirectorycompressor.h \
+    $$PWD/sffileanalyzer.h \
+    $$PWD/sfstaticcodec.h \
+    $$PWD/sftelemetry.h
@@ -0,0 +1,262 @@
+#include "sfdirectorycompressor.h"
+
+#include <QElapsedTimer>
+
+/**
+ * @brief SFDirectoryCompressor::SFDirectoryCompressor
+ * @param p_encoder configured encoder that did not encode anything yet, every file gets a copy
+ * @param p_block_size size of the blocks the files are split into
+ * @param p_header written in front of the blocks of every file
+ */
+SFDirectoryCompressor::SFDirectoryCompressor(const SFBlockEncoder& p_encoder, int p_block_size, const QByteArray& p_header):
+    m_encoder(p_encoder),
+    m_block_size(p_block_size),
+    m_header(p_header),
+    m_window(3),
+    m_output_bytes(0),
+    m_split_files(0),
+    m_batches(0)
+{
+
+}
+
+/**
+ * @brief SFDirectoryCompressor::run compresses the files
+ * @param p_files the files, the directories of the outputs have to exist
+ * @param p_threads number of threads
+ * @return false if a file could not be compressed (see failed())
+ */
+bool SFDirectoryCompressor::run(const QVector<File>& p_files, int p_threads)
+{
+    m_failed.clear();
+    m_output_bytes = 0;
+    m_split_files = 0;
+    m_batches = 0;
+    m_window = 3*qMax(p_threads, 1) + 3;
+
+    SFTaskPool pool(p_threads);
+    QVector<File> batch;
+    qint64 batch_bytes = 0;
+    for(const File& file:p_files)
+    {
+        if(file.size > m_block_size)
+        {
+            pool.spawn([this, &pool, file]() {split(pool, file);});
+            continue;
+        }
+
+        batch.append(file);
+        batch_bytes += file.size;
+        if(batch_bytes >= qint64(BATCH_BLOCKS)*m_block_size || batch.size() >= MAX_BATCH_FILES)
+        {
+            pool.spawn([this, batch]() {compressBatch(batch);});
+            m_batches++;
+            batch.clear();
+            batch_bytes = 0;
+        }
+    }
+    if(!batch.isEmpty())
+    {
+        pool.spawn([this, batch]() {compressBatch(batch);});
+        m_batches++;
+    }
+
+    pool.run();
+    m_thread_stats = pool.stats();
+    return m_failed.isEmpty();
+}
+
+/**
+ * @brief SFDirectoryCompressor::compressBatch compresses small files one after the other
+ */
+void SFDirectoryCompressor::compressBatch(const QVector<File>& p_files)
+{
+    for(const File& file:p_files)
+    {
+        QFile input(file.input);
+        if(!input.open(QIODevice::ReadOnly))
+        {
+            fail(file);
+            continue;
+        }
+        QByteArray data = input.readAll();
+
+        SFBlockEncoder encoder = m_encoder;
+        std::vector<QByteArray> blocks(1);
+        for(int pos = 0; pos < data.size(); pos += m_block_size)
+            encoder.encodeBlock(data.constData() + pos, qMin(m_block_size, data.size() - pos), blocks[0]);
+        if(!writeFile(file.output, blocks, encoder))
+            fail(file);
+    }
+}
+
+/**
+ * @brief SFDirectoryCompressor::split maps a large file, writes the header of its output and starts the first window of blocks
+ */
+void SFDirectoryCompressor::split(SFTaskPool& p_pool, const File& p_file)
+{
+    std::shared_ptr<SplitFile> split = std::make_shared<SplitFile>();
+    split->file = p_file;
+    split->input.setFileName(p_file.input);
+    if(split->input.open(QIODevice::ReadOnly) && split->input.size() > 0)
+        split->data = reinterpret_cast<const char*>(split->input.map(0, split->input.size()));
+    split->output.setFileName(p_file.output);
+    if(!split->data || !split->output.open(QIODevice::WriteOnly | QIODevice::Truncate)
+       || split->output.write(m_header) != m_header.size())
+    {
+        fail(p_file);
+        return;
+    }
+
+    split->count = int((split->input.size() + m_block_size - 1)/m_block_size);
+    int slots = qMin(split->count, m_window);
+    split->encoder = m_encoder;
+    split->blocks.resize(size_t(slots));
+    split->outputs.resize(size_t(slots));
+    split->analyzed.assign(size_t(slots), 0);
+    split->encoded.assign(size_t(slots), 0);
+    split->written = m_header.size();
+    split->next_analyze = slots;
+    m_split_files++;
+
+    for(int i = slots - 1; i >= 0; i--)     //the first block is taken first by this thread
+        startBlock(p_pool, split, i);
+}
+
+/**
+ * @brief SFDirectoryCompressor::startBlock puts a block into its slot and spawns its analyze task
+ *
+ * The slot has to be free: the block before it in the slot is written.
+ */
+void SFDirectoryCompressor::startBlock(SFTaskPool& p_pool, const std::shared_ptr<SplitFile>& p_split, int p_block)
+{
+    qint64 start = qint64(p_block)*m_block_size;
+    SFBlockEncoder::Block& block = p_split->blocks[size_t(p_block % p_split->slots())];
+    block = SFBlockEncoder::Block();
+    block.data = p_split->data + start;
+    block.size = int(qMin(qint64(m_block_size), p_split->input.size() - start));
+
+    std::shared_ptr<SplitFile> split = p_split;
+    p_pool.spawn([this, &p_pool, split, p_block]() {analyze(p_pool, split, p_block);});
+}
+
+/**
+ * @brief SFDirectoryCompressor::analyze builds the tables of a block
+ *
+ * The blocks are selected in their order (this is cheap since the tables are built), so this
+ * selects the block and the analyzed blocks behind it if the blocks in front of it are selected,
+ * and spawns the tasks that encode them.
+ */
+void SFDirectoryCompressor::analyze(SFTaskPool& p_pool, const std::shared_ptr<SplitFile>& p_split, int p_block)
+{
+    SplitFile& split = *p_split;
+    split.encoder.analyze(split.blocks[size_t(p_block % split.slots())], true);
+
+    std::vector<int> selected;
+    {
+        std::lock_guard<std::mutex> lock(split.select_mutex);
+        split.analyzed[size_t(p_block % split.slots())] = 1;
+        while(split.next_select < split.count && split.analyzed[size_t(split.next_select % split.slots())])
+        {
+            int slot = split.next_select % split.slots();
+            SFBlockEncoder::Block& block = split.blocks[size_t(slot)];
+            split.encoder.select(block);
+            block.histogram = QVector<quint64>();       //only needed by select()
+            block.new_table = SFCodeTable(0);           //the selected one is in block.table
+            split.analyzed[size_t(slot)] = 0;
+            selected.push_back(split.next_select++);
+        }
+    }
+
+    for(int block:selected)
+        p_pool.spawn([this, &p_pool, p_split, block]() {encode(p_pool, p_split, block);});
+}
+
+/**
+ * @brief SFDirectoryCompressor::encode encodes a block
+ *
+ * If the blocks in front of it are written, the block and the encoded blocks behind it are appended
+ * to the output and the blocks one window further are started. The task that writes the last
+ * block finishes the file.
+ */
+void SFDirectoryCompressor::encode(SFTaskPool& p_pool, const std::shared_ptr<SplitFile>& p_split, int p_block)
+{
+    SplitFile& split = *p_split;
+    int slot = p_block % split.slots();
+    SFBitWriter writer(&split.outputs[size_t(slot)]);
+    split.encoder.write(split.blocks[size_t(slot)], writer);
+
+    std::lock_guard<std::mutex> lock(split.write_mutex);
+    split.encoded[size_t(slot)] = 1;
+    while(split.next_write < split.count && split.encoded[size_t(split.next_write % split.slots())])
+    {
+        slot = split.next_write % split.slots();
+        QByteArray& output = split.outputs[size_t(slot)];
+        split.encoder.commit(split.blocks[size_t(slot)]);
+        if(!split.failed && split.output.write(output) != output.size())
+            split.failed = true;
+        split.written += output.size();
+        output.clear();
+        split.blocks[size_t(slot)] = SFBlockEncoder::Block();     //releases the tables
+        split.encoded[size_t(slot)] = 0;
+        split.next_write++;
+
+        if(split.next_analyze < split.count)
+            startBlock(p_pool, p_split, split.next_analyze++);
+        else if(split.next_write == split.count)
+            finish(split);
+    }
+}
+
+/**
+ * @brief SFDirectoryCompressor::finish appends the index to the output of a split file and closes it
+ */
+void SFDirectoryCompressor::finish(SplitFile& p_split)
+{
+    QByteArray index;
+    SFBitWriter writer(&index);
+    p_split.encoder.index().write(writer);
+    if(p_split.failed || p_split.output.write(index) != index.size() || !p_split.output.flush())
+        fail(p_split.file);
+    else
+        m_output_bytes += p_split.written + index.size();
+
+    p_split.output.close();
+    p_split.input.unmap(const_cast<uchar*>(reinterpret_cast<const uchar*>(p_split.data)));
+}
+
+/**
+ * @brief SFDirectoryCompressor::writeFile writes the header, the encoded blocks and the index of p_encoder
+ */
+bool SFDirectoryCompressor::writeFile(const QString& p_name, const std::vector<QByteArray>& p_blocks, const SFBlockEncoder& p_encoder)
+{
+    QByteArray index;
+    SFBitWriter writer(&index);
+    p_encoder.index().write(writer);
+
+    QFile output(p_name);
+    if(!output.open(QIODevice::WriteOnly | QIODevice::Truncate) || output.write(m_header) != m_header.size())
+        return false;
+
+    qint64 written = m_header.size();
+    for(const QByteArray& block:p_blocks)
+    {
+        if(output.write(block) != block.size())
+            return false;
+        written += block.size();
+    }
+    if(output.write(index) != index.size())
+        return false;
+
+    m_output_bytes += written + index.size();
+    return true;
+}
+
+/**
+ * @brief SFDirectoryCompressor::fail records a file that could not be compressed
+ */
+void SFDirectoryCompressor::fail(const File& p_file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_failed.append(p_file.input);
+}
@@ -0,0 +1,117 @@
+#ifndef SFDIRECTORYCOMPRESSOR_H
+#define SFDIRECTORYCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "sfblockcodec.h"
+#include "sftaskpool.h"
+
+/**
+ * \class SFDirectoryCompressor
+ * @brief Compresses many files at once as tasks of a SFTaskPool
+ *
+ * Every file is written as the container sfc compress writes: the header given to the constructor,
+ * the blocks and the index of the encoder. The output of a file does not depend on the number of
+ * threads or on the other files.
+ *
+ * Files of up to one block are batched: a task compresses small files one after the other until it
+ * read BATCH_BLOCKS blocks worth of them, so a tree of tiny files does not cost a task per file.
+ * Larger files are memory mapped and compressed in a window of blocks: a task per block counts the
+ * symbols and builds the tables (SFBlockEncoder::analyze()), the task that completes the next block in
+ * order selects the tables (SFBlockEncoder::select(), its histogram and unused table are dropped right
+ * away) and spawns the tasks that encode the blocks. The task that completes the next encoded block
+ * in order appends it to the output and spawns the analyze task of the block one window further. So at
+ * most a window (3 blocks per thread + 3, like SFPipeline) of a file is held in memory, however large
+ * the file is. Idle threads steal the oldest tasks, so one huge file is spread over all threads while a
+ * thread that split a file keeps working on its blocks.
+ */
+class SFDirectoryCompressor
+{
+public:
+    enum {BATCH_BLOCKS = 16, MAX_BATCH_FILES = 256};
+
+    /**
+     * @brief The File struct names an input file and its compressed output
+     */
+    struct File
+    {
+        QString input;
+        QString output;
+        qint64 size;
+    };
+
+    SFDirectoryCompressor(const SFBlockEncoder& p_encoder, int p_block_size, const QByteArray& p_header);
+
+    bool run(const QVector<File>& p_files, int p_threads);
+
+    const QStringList& failed() const {return m_failed;}
+    qint64 outputBytes() const {return m_output_bytes;}
+    int splitFiles() const {return m_split_files;}
+    int batches() const {return m_batches;}
+    const std::vector<SFTaskPool::ThreadStats>& threadStats() const {return m_thread_stats;}
+
+private:
+    Q_DISABLE_COPY(SFDirectoryCompressor)
+
+    /**
+     * @brief The SplitFile struct holds a file that is compressed block by block
+     *
+     * Block i is kept in slot i % slots of the ring buffers until it is written.
+     */
+    struct SplitFile
+    {
+        File file;
+        QFile input;
+        QFile output;
+        const char* data = 0;
+        SFBlockEncoder encoder;
+        int count = 0;                                  //blocks of the file
+        std::vector<SFBlockEncoder::Block> blocks;
+        std::vector<QByteArray> outputs;
+
+        std::mutex select_mutex;                        //guards analyzed and next_select
+        std::vector<char> analyzed;
+        int next_select = 0;
+
+        std::mutex write_mutex;                         //guards encoded, the output and everything below
+        std::vector<char> encoded;
+        int next_write = 0;
+        int next_analyze = 0;                           //next block that gets an analyze task
+        qint64 written = 0;
+        bool failed = false;
+
+        int slots() const {return int(blocks.size());}
+    };
+
+    void compressBatch(const QVector<File>& p_files);
+    void split(SFTaskPool& p_pool, const File& p_file);
+    void startBlock(SFTaskPool& p_pool, const std::shared_ptr<SplitFile>& p_split, int p_block);
+    void analyze(SFTaskPool& p_pool, const std::shared_ptr<SplitFile>& p_split, int p_block);
+    void encode(SFTaskPool& p_pool, const std::shared_ptr<SplitFile>& p_split, int p_block);
+    void finish(SplitFile& p_split);
+    bool writeFile(const QString& p_name, const std::vector<QByteArray>& p_blocks, const SFBlockEncoder& p_encoder);
+    void fail(const File& p_file);
+
+    SFBlockEncoder m_encoder;       //copied for every file
+    int m_block_size;
+    QByteArray m_header;
+    int m_window;                   //blocks of a split file in flight
+
+    std::mutex m_mutex;             //guards m_failed
+    QStringList m_failed;
+    std::atomic<qint64> m_output_bytes;
+    std::atomic<int> m_split_files;
+    int m_batches;
+    std::vector<SFTaskPool::ThreadStats> m_thread_stats;
+};
+
+#endif // SFDIRECTORYCOMPRESSOR_H
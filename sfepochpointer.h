@@ -0,0 +1,258 @@
+#ifndef SFEPOCHPOINTER_H
+#define SFEPOCHPOINTER_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * \class SFEpochPointer
+ * @brief Publishes immutable versions of an object to reading threads without locking them
+ *
+ * Readers work on the current version while a writer builds the next one and publish() swaps the
+ * pointer. The old version is deleted once no reader can still use it (epoch based reclamation):
+ * every reader thread owns a Reader, which holds a slot. While a Guard exists the slot holds the
+ * global epoch the reader started in. publish() increments the epoch and retires the old version
+ * with the epoch it was replaced in. A retired version is deleted when every slot is either idle
+ * or holds a younger epoch, since those readers loaded the pointer after the swap.
+ *
+ * Readers only store their slot and load the pointer, they never wait. Writers are serialized by a
+ * mutex and never wait for readers either, versions still in use are deleted by a later publish()
+ * or reclaim(). The versions must not be changed after they were published.
+ *
+ * There are MAX_READERS slots, so at most that many Readers can exist at the same time. A Reader
+ * created while all slots are taken is invalid, the owner has to limit its number of reading threads.
+ */
+template<class T>
+class SFEpochPointer
+{
+public:
+    enum {MAX_READERS = 256};
+
+    class Reader;
+
+    /**
+     * @brief The Guard class keeps the current version alive while it exists
+     */
+    class Guard
+    {
+    public:
+        explicit Guard(Reader& p_reader): m_reader(p_reader), m_value(p_reader.enter()) {}
+        ~Guard() {m_reader.leave();}
+
+        const T* get() const {return m_value;}
+        const T* operator->() const {return m_value;}
+        const T& operator*() const {return *m_value;}
+
+    private:
+        Q_DISABLE_COPY(Guard)
+
+        Reader& m_reader;
+        const T* m_value;
+    };
+
+    /**
+     * @brief The Reader class is the slot of one reading thread
+     *
+     * Construct one per thread and read through a Guard, guards of a reader must not overlap.
+     * If all slots are taken the reader is invalid and must not be read through.
+     */
+    class Reader
+    {
+    public:
+        explicit Reader(SFEpochPointer& p_pointer);
+        ~Reader();
+
+        bool isValid() const {return m_slot >= 0;}
+
+    private:
+        Q_DISABLE_COPY(Reader)
+        friend class SFEpochPointer::Guard;
+
+        const T* enter();
+        void leave();
+
+        SFEpochPointer& m_pointer;
+        int m_slot;
+    };
+
+    explicit SFEpochPointer(T* p_initial = new T());
+    ~SFEpochPointer();
+
+    quint64 publish(T* p_value);
+    template<class F> quint64 update(F p_change);
+    int reclaim();
+
+    quint64 version() const {return m_version;}
+
+private:
+    Q_DISABLE_COPY(SFEpochPointer)
+
+    struct alignas(64) Slot
+    {
+        std::atomic<quint64> epoch;     //0 if the reader is not reading
+        std::atomic<bool> used;
+    };
+
+    quint64 swapLocked(T* p_value);
+    int reclaimLocked();
+
+    std::atomic<const T*> m_current;
+    std::atomic<quint64> m_epoch;
+    std::atomic<quint64> m_version;
+    Slot m_slots[MAX_READERS];
+    std::mutex m_mutex;                                     //serializes the writers
+    std::vector<std::pair<quint64, const T*>> m_retired;   //epoch of the swap, old version
+};
+
+/**
+ * @brief SFEpochPointer::SFEpochPointer publishes p_initial as version 0 (takes ownership)
+ */
+template<class T>
+SFEpochPointer<T>::SFEpochPointer(T* p_initial):
+    m_current(p_initial),
+    m_epoch(1),
+    m_version(0)
+{
+    for(Slot& slot:m_slots)
+    {
+        slot.epoch.store(0, std::memory_order_relaxed);
+        slot.used.store(false, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief SFEpochPointer::~SFEpochPointer deletes all versions, no reader may be reading
+ */
+template<class T>
+SFEpochPointer<T>::~SFEpochPointer()
+{
+    delete m_current.load();
+    for(const std::pair<quint64, const T*>& retired:m_retired)
+        delete retired.second;
+}
+
+/**
+ * @brief SFEpochPointer::publish makes p_value the current version (takes ownership)
+ * @return the number of the new version
+ */
+template<class T>
+quint64 SFEpochPointer<T>::publish(T* p_value)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return swapLocked(p_value);
+}
+
+/**
+ * @brief SFEpochPointer::update publishes a changed copy of the current version
+ * @param p_change called with the copy (T&) before it is published
+ * @return the number of the new version
+ *
+ * The copy is made and changed while other writers wait, so concurrent updates are not lost.
+ */
+template<class T>
+template<class F>
+quint64 SFEpochPointer<T>::update(F p_change)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    T* value = new T(*m_current.load());       //only writers retire versions, so the current one stays alive
+    p_change(*value);
+    return swapLocked(value);
+}
+
+/**
+ * @brief SFEpochPointer::swapLocked replaces the current version and retires the old one
+ */
+template<class T>
+quint64 SFEpochPointer<T>::swapLocked(T* p_value)
+{
+    const T* old = m_current.exchange(p_value);
+    m_retired.push_back(std::make_pair(m_epoch.fetch_add(1), old));
+    reclaimLocked();
+    return ++m_version;
+}
+
+/**
+ * @brief SFEpochPointer::reclaim deletes the retired versions no reader can use anymore
+ * @return number of retired versions that are still in use
+ */
+template<class T>
+int SFEpochPointer<T>::reclaim()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return reclaimLocked();
+}
+
+template<class T>
+int SFEpochPointer<T>::reclaimLocked()
+{
+    quint64 oldest = m_epoch.load();
+    for(const Slot& slot:m_slots)
+    {
+        quint64 epoch = slot.epoch.load();
+        if(epoch != 0 && epoch < oldest)
+            oldest = epoch;
+    }
+
+    size_t kept = 0;
+    for(size_t i = 0; i < m_retired.size(); i++)
+    {
+        if(m_retired[i].first < oldest)     //every reader that might have loaded it has left
+            delete m_retired[i].second;
+        else
+            m_retired[kept++] = m_retired[i];
+    }
+    m_retired.resize(kept);
+    return int(kept);
+}
+
+/**
+ * @brief SFEpochPointer::Reader::Reader claims a free slot
+ *
+ * Does not wait if all slots are taken (that would never end if their readers live as long as
+ * their threads), the reader is invalid then (see isValid()).
+ */
+template<class T>
+SFEpochPointer<T>::Reader::Reader(SFEpochPointer& p_pointer):
+    m_pointer(p_pointer),
+    m_slot(-1)
+{
+    for(int slot = 0; slot < MAX_READERS && m_slot < 0; slot++)
+    {
+        bool used = false;
+        if(m_pointer.m_slots[slot].used.compare_exchange_strong(used, true))
+            m_slot = slot;
+    }
+}
+
+template<class T>
+SFEpochPointer<T>::Reader::~Reader()
+{
+    if(m_slot >= 0)
+        m_pointer.m_slots[m_slot].used.store(false);
+}
+
+/**
+ * @brief SFEpochPointer::Reader::enter announces the current epoch and loads the current version
+ *
+ * The epoch is stored before the pointer is loaded. A writer that finds the slot idle or younger than
+ * the epoch of a swap therefore knows this reader will load the new pointer.
+ */
+template<class T>
+const T* SFEpochPointer<T>::Reader::enter()
+{
+    Q_ASSERT(isValid());
+    m_pointer.m_slots[m_slot].epoch.store(m_pointer.m_epoch.load());
+    return m_pointer.m_current.load();
+}
+
+template<class T>
+void SFEpochPointer<T>::Reader::leave()
+{
+    m_pointer.m_slots[m_slot].epoch.store(0, std::memory_order_release);
+}
+
+#endif // SFEPOCHPOINTER_H
@@ -0,0 +1,121 @@
+#include "sffileanalyzer.h"
+
+#include "sfcodetable.h"
+
+SFFileAnalyzer::SFFileAnalyzer():
+    m_builder(&SFCodeBuilder::shannonFano()),
+    m_size(0),
+    m_state(IDLE),
+    m_bytes_done(0),
+    m_cancel(false),
+    m_encoded_bits(0)
+{
+
+}
+
+/**
+ * @brief SFFileAnalyzer::~SFFileAnalyzer cancels a running analysis and waits for the thread
+ */
+SFFileAnalyzer::~SFFileAnalyzer()
+{
+    cancel();
+    join();
+}
+
+/**
+ * @brief SFFileAnalyzer::start opens a file and starts counting its bytes
+ * @param p_file_name the file
+ * @param p_builder assigns the codes once the histogram is complete
+ * @return false if the file could not be opened (the state is FAILED then)
+ *
+ * A running analysis is canceled first.
+ */
+bool SFFileAnalyzer::start(const QString& p_file_name, const SFCodeBuilder& p_builder)
+{
+    cancel();
+    join();
+
+    m_file_name = p_file_name;
+    m_builder = &p_builder;
+    m_histogram = QVector<quint64>(256, 0);
+    m_index.clear();
+    m_encoded_bits = 0;
+    m_bytes_done = 0;
+    m_cancel = false;
+
+    m_file.close();
+    m_file.setFileName(p_file_name);
+    if(!m_file.open(QIODevice::ReadOnly))
+    {
+        m_size = 0;
+        m_state = FAILED;
+        return false;
+    }
+    m_size = m_file.size();
+
+    m_state = RUNNING;
+    m_thread = std::thread(&SFFileAnalyzer::run, this);
+    return true;
+}
+
+/**
+ * @brief SFFileAnalyzer::cancel asks the thread to stop after the current chunk
+ */
+void SFFileAnalyzer::cancel()
+{
+    m_cancel = true;
+}
+
+/**
+ * @brief SFFileAnalyzer::run counts the file chunk by chunk and builds the codes
+ */
+void SFFileAnalyzer::run()
+{
+    const char* data = (m_size > 0) ? reinterpret_cast<const char*>(m_file.map(0, m_size)) : 0;
+
+    QByteArray buffer;
+    qint64 done = 0;
+    while(done < m_size && !m_cancel)
+    {
+        const char* chunk;
+        qint64 length = qMin(qint64(CHUNK_SIZE), m_size - done);
+        if(data)
+            chunk = data + done;
+        else                                //not mappable, read instead
+        {
+            buffer = m_file.read(length);
+            if(buffer.isEmpty())
+                break;
+            chunk = buffer.constData();
+            length = buffer.size();
+        }
+
+        QVector<quint64> histogram = SFCodeTable::histogram(chunk, length);
+        for(int i = 0; i < m_histogram.size(); i++)
+            m_histogram[i] += histogram.at(i);
+        done += length;
+        m_bytes_done = done;
+    }
+    if(data)
+        m_file.unmap(const_cast<uchar*>(reinterpret_cast<const uchar*>(data)));
+    m_file.close();
+
+    if(done < m_size)
+    {
+        m_state = m_cancel ? CANCELED : FAILED;
+        return;
+    }
+
+    m_index = SFCodeTable::indexOfHistogram(m_histogram, *m_builder);
+    m_encoded_bits = SFCodeTable::fromIndex(m_index, m_histogram.size()).cost(m_histogram);   //NO_CODE if the table is empty
+    m_state = DONE;
+}
+
+/**
+ * @brief SFFileAnalyzer::join waits for the thread of the last start()
+ */
+void SFFileAnalyzer::join()
+{
+    if(m_thread.joinable())
+        m_thread.join();
+}
@@ -0,0 +1,68 @@
+#ifndef SFFILEANALYZER_H
+#define SFFILEANALYZER_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <thread>
+
+#include "sfcodebuilder.h"
+#include "sflist.h"
+
+/**
+ * \class SFFileAnalyzer
+ * @brief Counts the bytes of a file and builds its codes on a background thread
+ *
+ * The file is memory mapped (or read in chunks if it can not be mapped) and counted CHUNK_SIZE
+ * bytes at a time, so the memory use does not depend on the size of the file. After every chunk
+ * the progress is published and a cancel() request is checked. The owner polls state() and
+ * bytesDone(), once the state is DONE histogram(), index() and encodedBits() hold the result.
+ *
+ * The GUI uses this to show the codes of files that are too large to be pasted into the input field.
+ */
+class SFFileAnalyzer
+{
+public:
+    enum State {IDLE, RUNNING, DONE, CANCELED, FAILED};
+    enum {CHUNK_SIZE = 1 << 20};
+
+    SFFileAnalyzer();
+    ~SFFileAnalyzer();
+
+    bool start(const QString& p_file_name, const SFCodeBuilder& p_builder);
+    void cancel();
+
+    State state() const {return State(m_state.load());}
+    const QString& fileName() const {return m_file_name;}
+    const SFCodeBuilder& builder() const {return *m_builder;}
+    qint64 size() const {return m_size;}
+    qint64 bytesDone() const {return m_bytes_done;}
+
+    const QVector<quint64>& histogram() const {return m_histogram;}
+    const SFList& index() const {return m_index;}
+    quint64 encodedBits() const {return m_encoded_bits;}   //SFCodeTable::NO_CODE if a code is longer than 64 bits
+
+private:
+    Q_DISABLE_COPY(SFFileAnalyzer)
+
+    void run();
+    void join();
+
+    QString m_file_name;
+    QFile m_file;
+    const SFCodeBuilder* m_builder;
+    qint64 m_size;
+
+    std::thread m_thread;
+    std::atomic<int> m_state;
+    std::atomic<qint64> m_bytes_done;
+    std::atomic<bool> m_cancel;
+
+    QVector<quint64> m_histogram;   //written by the thread, read after it set DONE
+    SFList m_index;
+    quint64 m_encoded_bits;
+};
+
+#endif // SFFILEANALYZER_H
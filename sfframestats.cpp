@@ -0,0 +1,165 @@
+#include "sfframestats.h"
+
+#include <algorithm>
+
+/**
+ * @brief SFFrameStats::Frame::total returns the time of all phases of the frame
+ */
+qint64 SFFrameStats::Frame::total() const
+{
+    qint64 result = 0;
+    for(int i = 0; i < PHASES; i++)
+        result += nsecs[i];
+    return result;
+}
+
+SFFrameStats::SFFrameStats():
+    m_next(0),
+    m_running(false)
+{
+    m_calls_at_begin = SFTreeNode::callCounts();
+}
+
+/**
+ * @brief SFFrameStats::begin starts a new frame, a frame that was not ended is dropped
+ * @param p_action what the user did, shown in the report
+ */
+void SFFrameStats::begin(const QString& p_action)
+{
+    m_current.action = p_action;
+    for(int i = 0; i < PHASES; i++)
+        m_current.nsecs[i] = 0;
+    m_calls_at_begin = SFTreeNode::callCounts();
+    m_running = true;
+}
+
+/**
+ * @brief SFFrameStats::add adds time to a phase of the current frame
+ */
+void SFFrameStats::add(Phase p_phase, qint64 p_nsecs)
+{
+    if(m_running)
+        m_current.nsecs[p_phase] += p_nsecs;
+}
+
+/**
+ * @brief SFFrameStats::end stores the current frame
+ * @param p_nodes number of nodes of the tree that was drawn
+ * @param p_symbols number of symbols of the tree
+ */
+void SFFrameStats::end(int p_nodes, int p_symbols)
+{
+    if(!m_running)
+        return;
+
+    m_current.sum_branch_calls = SFTreeNode::callCounts().sum_branch - m_calls_at_begin.sum_branch;
+    m_current.depth_calls = SFTreeNode::callCounts().depth - m_calls_at_begin.depth;
+    m_current.nodes = p_nodes;
+    m_current.symbols = p_symbols;
+    m_running = false;
+
+    if(m_frames.size() < WINDOW)
+        m_frames.append(m_current);
+    else
+    {
+        m_frames[m_next] = m_current;
+        m_next = (m_next + 1) % WINDOW;
+    }
+}
+
+/**
+ * @brief SFFrameStats::last returns the newest frame, there has to be at least one
+ */
+const SFFrameStats::Frame& SFFrameStats::last() const
+{
+    Q_ASSERT(!m_frames.isEmpty());
+    return m_frames.at((m_next + m_frames.size() - 1) % m_frames.size());
+}
+
+/**
+ * @brief SFFrameStats::histogram counts the frames of the window by their total time
+ * @return BUCKETS counts, bucket i holds the frames below bucketLimit(i) (the last one all others)
+ */
+QVector<int> SFFrameStats::histogram() const
+{
+    QVector<int> result(BUCKETS, 0);
+    for(const Frame& frame:m_frames)
+    {
+        int bucket = 0;
+        while(bucket < BUCKETS - 1 && frame.total() >= bucketLimit(bucket))
+            bucket++;
+        result[bucket]++;
+    }
+    return result;
+}
+
+/**
+ * @brief SFFrameStats::bucketLimit returns the upper limit of a bucket of histogram() in nanoseconds (0.5 ms, 1 ms, 2 ms, ...)
+ */
+qint64 SFFrameStats::bucketLimit(int p_bucket)
+{
+    return qint64(500000) << p_bucket;
+}
+
+const char* SFFrameStats::phaseName(Phase p_phase)
+{
+    static const char* names[PHASES] = {"step", "depth", "paint", "upload"};
+    return names[p_phase];
+}
+
+/**
+ * @brief SFFrameStats::describe returns one line with the times and counts of a frame
+ */
+QString SFFrameStats::describe(const Frame& p_frame) const
+{
+    QString result = p_frame.action + ":";
+    for(int i = 0; i < PHASES; i++)
+        result += QString(" ") + phaseName(Phase(i)) + " " + QString::number(p_frame.nsecs[i]/1e6, 'f', 2);
+    result += " = " + QString::number(p_frame.total()/1e6, 'f', 2) + " ms, ";
+    result += QString::number(p_frame.nodes) + " nodes, " + QString::number(p_frame.symbols) + " symbols, ";
+    result += QString::number(p_frame.sum_branch_calls) + " sumBranch, " + QString::number(p_frame.depth_calls) + " depth calls";
+    return result;
+}
+
+/**
+ * @brief SFFrameStats::report returns a summary of the window for the overlay of the tree view
+ */
+QString SFFrameStats::report() const
+{
+    if(m_frames.isEmpty())
+        return "no frames yet";
+
+    const Frame& frame = last();
+    QString result = frame.action + "\n";
+    for(int i = 0; i < PHASES; i++)
+        result += QString(phaseName(Phase(i))).leftJustified(8) + QString::number(frame.nsecs[i]/1e6, 'f', 2).rightJustified(9) + " ms\n";
+    result += QString("total").leftJustified(8) + QString::number(frame.total()/1e6, 'f', 2).rightJustified(9) + " ms\n";
+    result += QString::number(frame.nodes) + " nodes, " + QString::number(frame.symbols) + " symbols\n";
+    result += QString::number(frame.sum_branch_calls) + " sumBranch, " + QString::number(frame.depth_calls) + " depth calls\n\n";
+
+    result += QString::number(m_frames.size()) + " frames: p50 " + QString::number(percentile(0.5)/1e6, 'f', 2)
+            + " p95 " + QString::number(percentile(0.95)/1e6, 'f', 2) + " max " + QString::number(percentile(1.0)/1e6, 'f', 2) + " ms\n";
+
+    QVector<int> buckets = histogram();
+    int highest = *std::max_element(buckets.begin(), buckets.end());
+    for(int i = 0; i < BUCKETS; i++)
+    {
+        QString label = (i < BUCKETS - 1) ? "<" + QString::number(bucketLimit(i)/1e6) : ">=" + QString::number(bucketLimit(i - 1)/1e6);
+        result += (label + " ms").rightJustified(9) + " " + QString(highest ? 20*buckets.at(i)/highest : 0, '#').leftJustified(20)
+                + QString::number(buckets.at(i)).rightJustified(5) + "\n";
+    }
+    return result;
+}
+
+/**
+ * @brief SFFrameStats::percentile returns the total time that p_fraction of the frames of the window do not exceed
+ */
+qint64 SFFrameStats::percentile(double p_fraction) const
+{
+    QVector<qint64> totals;
+    for(const Frame& frame:m_frames)
+        totals.append(frame.total());
+    std::sort(totals.begin(), totals.end());
+    int index = qMin(int(p_fraction*totals.size()), totals.size() - 1);
+    return totals.at(index);
+}
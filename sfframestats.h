@@ -0,0 +1,67 @@
+#ifndef SFFRAMESTATS_H
+#define SFFRAMESTATS_H
+
+#include <QString>
+#include <QVector>
+
+#include "sftreenode.h"
+
+/**
+ * \class SFFrameStats
+ * @brief Records how long the tree view took to react to an action
+ *
+ * A frame is one action in the GUI (a step, a step back, building a new tree, ...) together with
+ * redrawing the tree. MainWindow calls begin(), adds the time of every phase and calls end() once
+ * the pixmap is set. The number of sumBranch() and depth() calls made in between (see
+ * SFTreeNode::callCounts()) and the size of the tree are stored with the times.
+ *
+ * The last WINDOW frames are kept. report() shows the last frame, the median, 95th percentile and
+ * maximum of the window and a histogram of the frame times in buckets of doubling width.
+ */
+class SFFrameStats
+{
+public:
+    enum Phase {STEP, DEPTH, PAINT, UPLOAD, PHASES};
+    enum {WINDOW = 128, BUCKETS = 9};
+
+    /**
+     * @brief The Frame struct holds the times and counts of one action
+     */
+    struct Frame
+    {
+        QString action;
+        qint64 nsecs[PHASES];
+        qint64 sum_branch_calls;
+        qint64 depth_calls;
+        int nodes;
+        int symbols;
+
+        qint64 total() const;
+    };
+
+    SFFrameStats();
+
+    void begin(const QString& p_action);
+    void add(Phase p_phase, qint64 p_nsecs);
+    void end(int p_nodes, int p_symbols);
+
+    int frames() const {return m_frames.size();}
+    const Frame& last() const;
+    QVector<int> histogram() const;
+    static qint64 bucketLimit(int p_bucket);
+    static const char* phaseName(Phase p_phase);
+
+    QString describe(const Frame& p_frame) const;
+    QString report() const;
+
+private:
+    qint64 percentile(double p_fraction) const;
+
+    QVector<Frame> m_frames;    //ring buffer of the last WINDOW frames
+    int m_next;                 //where the next frame is stored once the window is full
+    Frame m_current;
+    bool m_running;
+    SFTreeNode::CallCounts m_calls_at_begin;
+};
+
+#endif // SFFRAMESTATS_H
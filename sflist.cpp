@@ -1,5 +1,12 @@
 #include "sflist.h"
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "sftaskpool.h"
+
 SFList::SFList():
     QList<Symbol>()
 {
@@ -15,61 +22,231 @@ SFList::SFList(QList<Symbol> list) :
 
 
 /**
- * @brief SFList::sum sums the probability of all symbols in this list
- * @return return propability of all symbols in this list
+ * @brief SFList::sum sums the counts of all symbols in this list
+ * @return number of occurences of all symbols in this list
  */
-inline double SFList::sum() const
+qint64 SFList::sum() const
 {
-    double t_sum = 0;
+    qint64 t_sum = 0;
 
     for(auto entry:*this)
-        t_sum += entry.getProb();
+        t_sum += entry.getCount();
     return t_sum;
 }
 
 /**
- * @brief SFList::sum return sum of probabilities of symbols in [it1,it2)
+ * @brief SFList::sum return sum of counts of symbols in [it1,it2)
  * @param it1 SFList::iterator first element to be summed
  * @param it2 SFList::iterator to behind the last element to be summed
- * @return sum of probabilities between the two iterators
+ * @return sum of counts between the two iterators
  */
-inline double SFList::sum(const SFList::iterator it1, const SFList::iterator it2)
+qint64 SFList::sum(const SFList::iterator it1, const SFList::iterator it2)
 {
 
-    double sum = 0;
+    qint64 sum = 0;
     for(SFList::iterator i = it1; i != it2; i++)
     {
-        sum += i->getProb();
+        sum += i->getCount();
     }
     return sum;
 }
 
 /**
- * @brief SFList::split split list [it1,it2) so that both have an equal sum of propabilities
+ * @brief SFList::sortByCount sorts the list from the highest to the lowest count, equal counts by symbol value
+ *
+ * Every symbol gets a compact key ((INT_MAX - count) << 16 | symbol value) and the positions are sorted
+ * by a LSD radix sort with 8 bit digits (digits that are equal for all keys are skipped). The symbols
+ * are then moved to their place by following the cycles of the permutation, so no Symbol is copied.
+ * The result does not depend on the original order, so every list with the same counts is sorted the same way.
+ */
+void SFList::sortByCount()
+{
+    int n = size();
+    if(n < 2)
+        return;
+
+    std::vector<quint64> keys(n);
+    std::vector<int> order(n), buffer(n);
+    for(int i = 0; i < n; i++)
+    {
+        quint64 inverted = quint64(std::numeric_limits<int>::max() - std::max(at(i).getCount(), 0));
+        keys[i] = (inverted << 16) | at(i).getSym().unicode();
+        order[i] = i;
+    }
+
+    for(int shift = 0; shift < 48; shift += 8)
+    {
+        int offsets[257] = {0};
+        for(int i = 0; i < n; i++)
+            offsets[((keys[i] >> shift) & 0xFF) + 1]++;
+        if(offsets[((keys[0] >> shift) & 0xFF) + 1] == n)     //all keys share this digit
+            continue;
+
+        for(int digit = 0; digit < 256; digit++)
+            offsets[digit+1] += offsets[digit];
+        for(int i = 0; i < n; i++)
+            buffer[offsets[(keys[order[i]] >> shift) & 0xFF]++] = order[i];
+        order.swap(buffer);
+    }
+
+    for(int i = 0; i < n; i++)      //position j has to receive the symbol at order[j]
+    {
+        int j = i;
+        while(order[j] != j)
+        {
+            int k = order[j];
+            order[j] = j;
+            if(k == i)
+                break;
+            swap(j, k);
+            j = k;
+        }
+    }
+}
+
+/**
+ * @brief SFList::split split list [it1,it2) so that both have an equal sum of counts
  * @param it1 SFList::iterator pointing to the first element of the range
  * @param it2 SFList::iterator to behind the last element of the range
  * @return SFList::iterator iter so that sum[it1,iter) == sum[iter,it2)
  */
-SFList::iterator SFList::split(const SFList::iterator it1, const SFList::iterator it2) //There is an exact solution to this problem in pseudo-linear time but i chose an easier heuristic that grants adequate results
+SFList::iterator SFList::split(const SFList::iterator it1, const SFList::iterator it2)
+{
+    QVector<qint64> prefix(int(it2-it1) + 1, 0);
+    for(SFList::iterator i = it1; i != it2; i++)
+        prefix[i-it1+1] = prefix.at(i-it1) + i->getCount();
+    return split(it1, it2, prefix.constData());
+}
+
+/**
+ * @brief SFList::split split list [it1,it2) using precalculated prefix sums
+ * @param p_prefix p_prefix[i] is the sum of the counts of all symbols in front of it1+i
+ * (the prefix sums may start at any symbol in front of it1, only differences are used)
+ * @return SFList::iterator iter so that sum[it1,iter) == sum[iter,it2). Both parts contain at least one symbol
+ *
+ * The comparisons are done with doubled sums so no division (and no rounding) is needed.
+ */
+SFList::iterator SFList::split(const SFList::iterator it1, const SFList::iterator it2, const qint64* p_prefix) //There is an exact solution to this problem in pseudo-linear time but i chose an easier heuristic that grants adequate results
 {
+    int size = int(it2-it1);
+    if(size < 2)
+        return it2;
 
-    qDebug() << "list size:" << it2-it1;
-    SFList::iterator iter = it2;
+    qint64 first = p_prefix[0];
+    qint64 total = p_prefix[size] - first;
 
-    if(it2-it1 > 1)
+    //first position at or to the right of the best balance (the prefix sums are sorted)
+    int pos = int(std::lower_bound(p_prefix + 1, p_prefix + size, total,
+                                   [first](qint64 p_sum, qint64 p_total){return 2*(p_sum - first) < p_total;}) - p_prefix);
+
+    qint64 left = p_prefix[pos] - first;
+    qint64 left_before = p_prefix[pos-1] - first;
+    if((2*left - total) > (total - 2*left_before))   //check if best balance is one to the left
+        pos--;
+
+    pos = std::max(1, std::min(pos, size-1));
+    return it1 + pos;
+}
+
+/**
+ * @brief SFList::assignCodes creates the codes by recursivly calling itself
+ * @param it1 SFList::iterator to the first relevant Symbol
+ * @param it2 SFList::iterator to the address behind the last releveant Symbol
+ * The SFList between the iterators has to be sorted!!!
+ * This function calculates the prefix sums of the counts once and calls
+ * SFList::assignCodesHelper() which adds a code to each character
+ *
+ * The bits are collected in a CodeSlot per symbol and every code is turned into a QString once at
+ * the end, instead of appending a character to every symbol on every level. The two halves of a
+ * split are independent, so lists of at least 2*PARALLEL_CUTOFF symbols are split by the tasks of a
+ * SFTaskPool with one thread per core. Each task only writes the slots of its own range.
+ */
+void SFList::assignCodes(const SFList::iterator it1, const SFList::iterator it2)
+{
+    int size = int(it2-it1);
+    QVector<qint64> prefix(size + 1, 0);
+    for(SFList::iterator i = it1; i != it2; i++)
+        prefix[i-it1+1] = prefix.at(i-it1) + i->getCount();
+
+    std::vector<CodeSlot> slots(size_t(size), CodeSlot{0, 0});
+    int threads = int(std::thread::hardware_concurrency());
+    if(size >= 2*PARALLEL_CUTOFF && threads > 1)
     {
-        iter = it1;
-        double half = SFList::sum(it1, it2)/2.0;
-        double sum = 0;
+        SFTaskPool pool(threads);
+        pool.spawn([&]() {assignCodesHelper(it1, it2, prefix.constData(), slots.data(), &pool);});
+        pool.run();
+    }
+    else
+        assignCodesHelper(it1, it2, prefix.constData(), slots.data(), 0);
 
+    for(int i = 0; i < size; i++)
+    {
+        const CodeSlot& slot = slots[size_t(i)];
+        QString code(slot.length, QChar('0'));
+        for(int bit = 0; bit < slot.length; bit++)
+        {
+            if((slot.bits >> (slot.length - 1 - bit)) & 1)
+                code[bit] = QChar('1');
+        }
+        Symbol& sym = *(it1 + i);
+        sym.setCode(code + sym.getCode());     //bits behind the first 64 were appended directly
+    }
+}
 
-        while(sum < half) //increase pointer until at or to the right of the best balance
+/**
+ * @brief SFList::assignCodesHelper creates the codes by recursivly calling itself
+ * @param p_prefix prefix sums of the counts starting at it1 (see SFList::split())
+ * @param p_slots the CodeSlots of the symbols starting at it1
+ * @param p_pool spawns the larger half as a task if it has at least PARALLEL_CUTOFF symbols, 0 to run serially
+ * 1.) devide the vector into two vectors with equal counts
+ * 2.) add a zero to the left and a one to the right vector
+ * 3.) call this function recursivly for both parts of the list
+ */
+void SFList::assignCodesHelper(const SFList::iterator it1, const SFList::iterator it2, const qint64* p_prefix,
+                               CodeSlot* p_slots, SFTaskPool* p_pool)
+{
+    SFList::iterator mid = SFList::split(it1, it2, p_prefix);          //(1)
+
+    int left = int(mid - it1), right = int(it2 - mid);
+    for(int i = 0; i < left; i++)                                       //(2)
+        appendBit(*(it1 + i), p_slots[i], 0);
+    for(int i = 0; i < right; i++)
+        appendBit(*(mid + i), p_slots[left + i], 1);
+
+    if(p_pool && qMax(left, right) >= PARALLEL_CUTOFF)                  //(3)
+    {
+        if(left >= right)
         {
-            sum += iter->getProb();
-            iter++;
+            p_pool->spawn([=]() {assignCodesHelper(it1, mid, p_prefix, p_slots, p_pool);});
+            left = 0;
         }
-        if( (sum-half) > (half-SFList::sum(it1, iter-1)))   //check if best balance is one to the left
-            iter--;
+        else
+        {
+            p_pool->spawn([=]() {assignCodesHelper(mid, it2, p_prefix + (mid-it1), p_slots + (mid-it1), p_pool);});
+            right = 0;
+        }
+    }
+    if(left > 1)
+        assignCodesHelper(it1, mid, p_prefix, p_slots, p_pool);
+    if(right > 1)
+        assignCodesHelper(mid, it2, p_prefix + (mid-it1), p_slots + (mid-it1), p_pool);
+}
+
+/**
+ * @brief SFList::appendBit appends a bit to the code of a symbol
+ *
+ * The first 64 bits go into the slot. Codes that are even longer get the rest appended to the
+ * QString of the symbol directly, assignCodes() puts the bits of the slot in front of them.
+ * Such codes can only be shown (the GUI): SFCodeTable holds at most 64 bits per code and
+ * SFCodeTable::write() stores the length in 6 bits, so a table for encoding can not be built from them.
+ */
+void SFList::appendBit(Symbol& p_sym, CodeSlot& p_slot, int p_bit)
+{
+    if(p_slot.length < 64)
+    {
+        p_slot.bits = (p_slot.bits << 1) | quint64(p_bit);
+        p_slot.length++;
     }
-    return iter;
+    else
+        p_sym.appendCode(p_bit ? "1" : "0");
 }
@@ -7,11 +7,15 @@
 #include <QObject>
 #include "symbol.h"
 
+class SFTaskPool;
+
 /**
  *\class
  * @brief The SFList class is an expansion of QList adding functionality needed for SFCodec
  *
  * The SFList expands QList adding "<<" und ">>" operatoren, a sum and a split function.
+ * All sums are calculated from the integer counts of the symbols (64 bit), the probabilities
+ * are only used for display. That way the codes are exactly the same on every platform and build.
  */
 class SFList : public QList<Symbol>
 {
@@ -22,13 +26,29 @@ public:
     void operator>>(SFList& vec_right){vec_right.prepend(this->last()); this->pop_back();}        //takes last element and puts it at the beginning of vec_right then deletes in this vector
     void operator<<(SFList& vec_right){this->append(vec_right.first()); vec_right.pop_front();}    //takes the first element of the other vector and adds it at the end of this
 
-    double sum() const;
+    qint64 sum() const;
+    void sortByCount();
 
 
     static SFList::iterator split(const SFList::iterator it1, const SFList::iterator it2);
-    static inline double sum(const SFList::iterator it1, const SFList::iterator it2);
-private:
+    static SFList::iterator split(const SFList::iterator it1, const SFList::iterator it2, const qint64* p_prefix);
+    static void assignCodes(const SFList::iterator it1, const SFList::iterator it2);
+    static qint64 sum(const SFList::iterator it1, const SFList::iterator it2);
 
+    enum {PARALLEL_CUTOFF = 1 << 14};   //ranges of at least this many symbols are split by tasks of their own
+private:
+    /**
+     * @brief The CodeSlot struct collects the first 64 bits of the code of a symbol (see assignCodes())
+     */
+    struct CodeSlot
+    {
+        quint64 bits;
+        int length;
+    };
+
+    static void assignCodesHelper(const SFList::iterator it1, const SFList::iterator it2, const qint64* p_prefix,
+                                  CodeSlot* p_slots, SFTaskPool* p_pool);
+    static void appendBit(Symbol& p_sym, CodeSlot& p_slot, int p_bit);
 
 };
 
@@ -0,0 +1,193 @@
+#include "sfmodel.h"
+
+#include <cstring>
+
+SFModel::SFModel():
+    m_file(),
+    m_table(0),
+    m_id(0)
+{
+
+}
+
+SFModel::~SFModel()
+{
+    m_table = SFCodeTable(0);   //release the view on the mapped file before it is closed
+}
+
+/**
+ * @brief SFModel::histogramOfFiles counts the byte values of all given files
+ * @param p_file_names the sample corpus
+ * @return histogram over all files. Files that can not be opened are skipped
+ */
+QVector<quint64> SFModel::histogramOfFiles(const QStringList& p_file_names)
+{
+    QVector<quint64> result(256, 0);
+
+    for(const QString& name:p_file_names)
+    {
+        QFile file(name);
+        if(!file.open(QIODevice::ReadOnly))
+            continue;
+
+        while(!file.atEnd())
+        {
+            QByteArray chunk = file.read(1 << 20);
+            QVector<quint64> histogram = SFCodeTable::histogram(chunk.constData(), chunk.size());
+            for(int i = 0; i < result.size(); i++)
+                result[i] += histogram.at(i);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief SFModel::train builds the table of a model
+ * @param p_histogram histogram of the sample corpus
+ * @param p_builder the algorithm that assigns the codes
+ * @return SFCodeTable with a code for every byte value
+ */
+SFCodeTable SFModel::train(const QVector<quint64>& p_histogram, const SFCodeBuilder& p_builder)
+{
+    QVector<quint64> histogram = p_histogram;
+    for(quint64& count:histogram)
+    {
+        if(count == 0)      //the model has to be able to encode bytes that were not in the corpus
+            count = 1;
+    }
+    return SFCodeTable::fromHistogram(histogram, p_builder);
+}
+
+/**
+ * @brief SFModel::tableId calculates a checksum (32 bit FNV-1a) of the table
+ *
+ * The id is stored in compressed files so the decoder can check that it uses the right model.
+ */
+quint32 SFModel::tableId(const SFCodeTable& p_table)
+{
+    quint32 hash = 2166136261u;
+    for(int i = 0; i < p_table.alphabetSize(); i++)
+    {
+        const SFCode& code = p_table.code(i);
+        for(int byte = 0; byte < 8; byte++)
+            hash = (hash ^ quint8(code.bits >> (8*byte))) * 16777619u;
+        hash = (hash ^ quint8(code.length)) * 16777619u;
+    }
+    return hash ? hash : 1;     //0 means "no model"
+}
+
+/**
+ * @brief SFModel::save writes p_table into a model file
+ * @return false if the file could not be written
+ */
+bool SFModel::save(const SFCodeTable& p_table, const QString& p_file_name)
+{
+    QFile file(p_file_name);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SFM1", 4);
+    header.id = tableId(p_table);
+    header.alphabet_size = quint32(p_table.alphabetSize());
+    header.order_size = quint32(p_table.orderSize());
+    header.tree_size = quint32(p_table.treeSize());
+
+    qint64 written = file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    written += file.write(reinterpret_cast<const char*>(p_table.codes()), p_table.alphabetSize()*sizeof(SFCode));
+    written += file.write(reinterpret_cast<const char*>(p_table.order()), p_table.orderSize()*sizeof(qint32));
+    written += file.write(reinterpret_cast<const char*>(p_table.tree()), p_table.treeSize()*sizeof(qint32));
+
+    return written == qint64(sizeof(header) + p_table.alphabetSize()*sizeof(SFCode)
+                             + (p_table.orderSize() + p_table.treeSize())*sizeof(qint32));
+}
+
+/**
+ * @brief SFModel::load memory maps a model file
+ * @return false if the file can not be mapped or is no valid model (see SFModel::isValid())
+ */
+bool SFModel::load(const QString& p_file_name)
+{
+    m_table = SFCodeTable(0);
+    m_id = 0;
+    if(m_file.isOpen())
+        m_file.close();
+
+    m_file.setFileName(p_file_name);
+    if(!m_file.open(QIODevice::ReadOnly) || m_file.size() < qint64(sizeof(Header)))
+    {
+        m_file.close();
+        return false;
+    }
+
+    uchar* data = m_file.map(0, m_file.size());
+    if(!data)
+    {
+        m_file.close();
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+    qint64 codes_offset = sizeof(Header);
+    qint64 order_offset = codes_offset + qint64(header->alphabet_size)*sizeof(SFCode);
+    qint64 tree_offset = order_offset + qint64(header->order_size)*sizeof(qint32);
+    qint64 end = tree_offset + qint64(header->tree_size)*sizeof(qint32);
+
+    const char* base = reinterpret_cast<const char*>(data);
+    if(std::memcmp(header->magic, "SFM1", 4) != 0 || header->alphabet_size != 256 || end != m_file.size()
+       || !isValid(reinterpret_cast<const SFCode*>(base + codes_offset), int(header->alphabet_size),
+                   reinterpret_cast<const qint32*>(base + order_offset), qint64(header->order_size),
+                   reinterpret_cast<const qint32*>(base + tree_offset), qint64(header->tree_size)))
+    {
+        m_file.unmap(data);
+        m_file.close();
+        return false;
+    }
+
+    m_table = SFCodeTable::fromRawData(base + codes_offset, int(header->alphabet_size),
+                                       base + order_offset, int(header->order_size),
+                                       base + tree_offset, int(header->tree_size));
+    m_id = header->id;
+    return true;
+}
+
+/**
+ * @brief SFModel::isValid checks the arrays of a mapped model before a table is made of them
+ * @return false if an index points outside of the arrays or a code is too long to be encoded
+ *
+ * Every symbol in the order array has to have a code (and every code an entry in it). A tree entry
+ * is either a leaf with a symbol of the alphabet, 0 for a missing branch or an inner node behind its
+ * parent (that is how SFCodeTable::insert() builds the tree), so walking the tree always ends.
+ */
+bool SFModel::isValid(const SFCode* p_codes, int p_alphabet_size, const qint32* p_order, qint64 p_order_size,
+                      const qint32* p_tree, qint64 p_tree_size)
+{
+    if(p_order_size > p_alphabet_size || p_tree_size < 2 || p_tree_size % 2 != 0 || p_tree_size > 2*64*qint64(p_alphabet_size))
+        return false;
+
+    int coded = 0;
+    for(int symbol = 0; symbol < p_alphabet_size; symbol++)
+    {
+        if(p_codes[symbol].length < 0 || p_codes[symbol].length > 64)
+            return false;
+        coded += (p_codes[symbol].length > 0);
+    }
+    if(coded != p_order_size)
+        return false;
+
+    for(qint64 i = 0; i < p_order_size; i++)
+    {
+        if(p_order[i] < 0 || p_order[i] >= p_alphabet_size || p_codes[p_order[i]].length == 0)
+            return false;
+    }
+
+    for(qint64 i = 0; i < p_tree_size; i++)
+    {
+        qint32 node = p_tree[i];
+        if(SFCodeTable::isLeaf(node) ? SFCodeTable::leafSymbol(node) >= p_alphabet_size
+                                     : (node != SFCodeTable::root() && (node <= i/2 || node >= p_tree_size/2)))
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,62 @@
+#ifndef SFMODEL_H
+#define SFMODEL_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "sfcodetable.h"
+
+/**
+ * \class SFModel
+ * @brief A pretrained code table stored in a file
+ *
+ * SFModel::train() builds a table from the histogram of a sample corpus. Every byte value
+ * gets a code (missing ones are counted once) so the table can encode any input.
+ * SFModel::save() writes the table in its in-memory layout and SFModel::load() memory maps
+ * the file and uses it directly, so neither a histogram nor a table has to be built.
+ *
+ * File layout (native byte order):
+ * Header (32 bytes): magic "SFM1", id, alphabet size, order size, tree size, 3 reserved words
+ * followed by the SFCode array, the order array and the decode tree of the table.
+ */
+class SFModel
+{
+public:
+    SFModel();
+    ~SFModel();
+
+    static QVector<quint64> histogramOfFiles(const QStringList& p_file_names);
+    static SFCodeTable train(const QVector<quint64>& p_histogram, const SFCodeBuilder& p_builder = SFCodeBuilder::shannonFano());
+    static quint32 tableId(const SFCodeTable& p_table);
+    static bool save(const SFCodeTable& p_table, const QString& p_file_name);
+
+    bool load(const QString& p_file_name);
+    bool isLoaded() const {return !m_table.isEmpty();}
+
+    quint32 id() const {return m_id;}
+    const SFCodeTable& table() const {return m_table;}
+
+private:
+    Q_DISABLE_COPY(SFModel)     //the table points into the mapped file
+
+    static bool isValid(const SFCode* p_codes, int p_alphabet_size, const qint32* p_order, qint64 p_order_size,
+                        const qint32* p_tree, qint64 p_tree_size);
+
+    struct Header
+    {
+        char magic[4];
+        quint32 id;
+        quint32 alphabet_size;
+        quint32 order_size;
+        quint32 tree_size;
+        quint32 reserved[3];
+    };
+
+    QFile m_file;
+    SFCodeTable m_table;
+    quint32 m_id;
+};
+
+#endif // SFMODEL_H
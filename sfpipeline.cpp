@@ -0,0 +1,260 @@
+#include "sfpipeline.h"
+
+#include <QElapsedTimer>
+
+#include <thread>
+
+/**
+ * @brief SFPipeline::SFPipeline creates a pipeline that encodes with p_encoder
+ * @param p_encoder the encoder, it must not be used by others while run() is running
+ * @param p_block_size size of the blocks the input is split into
+ * @param p_workers number of threads of the analyze and of the encode stage
+ */
+SFPipeline::SFPipeline(SFBlockEncoder& p_encoder, int p_block_size, int p_workers):
+    m_encoder(p_encoder),
+    m_block_size(p_block_size),
+    m_workers(qMax(p_workers, 1)),
+    m_jobs(3*m_workers + 3),
+    m_free(int(m_jobs.size())),
+    m_to_analyze(2*m_workers),
+    m_to_select(2*m_workers),
+    m_to_encode(2*m_workers),
+    m_to_write(2*m_workers),
+    m_analyzing(0),
+    m_encoding(0),
+    m_failed(false),
+    m_elapsed_nsecs(0)
+{
+
+}
+
+/**
+ * @brief SFPipeline::run encodes p_input and writes the blocks to p_output
+ * @return false if reading or writing failed
+ *
+ * Only the blocks are written, the index of the encoder (SFBlockEncoder::index()) is complete
+ * when run() returns.
+ */
+bool SFPipeline::run(QIODevice& p_input, QIODevice& p_output)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    m_failed = false;
+    m_analyzing = m_workers;
+    m_encoding = m_workers;
+    for(int stage = 0; stage < STAGES; stage++)
+    {
+        m_busy[stage] = 0;
+        m_items[stage] = 0;
+    }
+    for(Job& job:m_jobs)
+    {
+        job.input.resize(m_block_size);
+        m_free.push(&job);
+    }
+
+    std::vector<std::thread> threads;
+    threads.push_back(std::thread(&SFPipeline::read, this, std::ref(p_input)));
+    for(int i = 0; i < m_workers; i++)
+        threads.push_back(std::thread(&SFPipeline::analyze, this));
+    threads.push_back(std::thread(&SFPipeline::select, this));
+    for(int i = 0; i < m_workers; i++)
+        threads.push_back(std::thread(&SFPipeline::encode, this));
+    threads.push_back(std::thread(&SFPipeline::write, this, std::ref(p_output)));
+    for(std::thread& thread:threads)
+        thread.join();
+
+    Job* job = 0;
+    while(m_free.tryPop(job))       //all jobs are back in m_free
+    {
+    }
+
+    const char* names[STAGES] = {"read", "analyze", "select", "encode", "write"};
+    const int threads_of[STAGES] = {1, m_workers, 1, m_workers, 1};
+    m_stats.clear();
+    for(int stage = 0; stage < STAGES; stage++)
+    {
+        StageStats stats = {names[stage], threads_of[stage], m_items[stage].load(), m_busy[stage].load()};
+        m_stats.append(stats);
+    }
+    m_elapsed_nsecs = timer.nsecsElapsed();
+    return !m_failed;
+}
+
+/**
+ * @brief SFPipeline::read reads the input block by block into free jobs
+ *
+ * A null job tells every analyze thread that the input ended.
+ */
+void SFPipeline::read(QIODevice& p_input)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 waited = 0;
+
+    for(qint64 sequence = 0; !m_failed; sequence++)
+    {
+        Job* job = 0;
+        waited += m_free.pop(job);
+
+        qint64 size = 0;
+        while(size < m_block_size)
+        {
+            qint64 bytes = p_input.read(job->input.data() + size, m_block_size - size);
+            if(bytes <= 0)
+            {
+                m_failed = m_failed || bytes < 0;
+                break;
+            }
+            size += bytes;
+        }
+        if(size == 0)
+        {
+            m_free.push(job);
+            break;
+        }
+
+        job->sequence = sequence;
+        job->block = SFBlockEncoder::Block();
+        job->block.data = job->input.constData();
+        job->block.size = int(size);
+        m_items[READ]++;
+        waited += m_to_analyze.push(job);
+    }
+
+    for(int i = 0; i < m_workers; i++)
+        waited += m_to_analyze.push(0);
+    addBusy(READ, timer.nsecsElapsed() - waited);
+}
+
+/**
+ * @brief SFPipeline::analyze counts the symbols and builds the tables of the blocks (in any order)
+ */
+void SFPipeline::analyze()
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 waited = 0;
+
+    Job* job = 0;
+    for(waited += m_to_analyze.pop(job); job; waited += m_to_analyze.pop(job))
+    {
+        m_encoder.analyze(job->block, true);
+        m_items[ANALYZE]++;
+        waited += m_to_select.push(job);
+    }
+
+    qint64 busy = timer.nsecsElapsed() - waited;
+    lastWorker(m_analyzing, m_to_select);
+    addBusy(ANALYZE, busy);
+}
+
+/**
+ * @brief SFPipeline::select selects the tables of the blocks in their order
+ *
+ * Blocks that arrive before their predecessors wait in a map. There are never more of them than jobs.
+ */
+void SFPipeline::select()
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 waited = 0;
+
+    std::map<qint64, Job*> pending;
+    qint64 next = 0;
+    Job* job = 0;
+    for(waited += m_to_select.pop(job); job; waited += m_to_select.pop(job))
+    {
+        pending[job->sequence] = job;
+        for(std::map<qint64, Job*>::iterator it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), next++)
+        {
+            m_encoder.select(it->second->block);
+            m_items[SELECT]++;
+            waited += m_to_encode.push(it->second);
+        }
+    }
+    Q_ASSERT(pending.empty());
+
+    for(int i = 0; i < m_workers; i++)
+        waited += m_to_encode.push(0);
+    addBusy(SELECT, timer.nsecsElapsed() - waited);
+}
+
+/**
+ * @brief SFPipeline::encode encodes the blocks into the output buffers of their jobs (in any order)
+ */
+void SFPipeline::encode()
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 waited = 0;
+
+    Job* job = 0;
+    for(waited += m_to_encode.pop(job); job; waited += m_to_encode.pop(job))
+    {
+        job->output.resize(0);
+        SFBitWriter writer(&job->output);
+        m_encoder.write(job->block, writer);
+        m_items[ENCODE]++;
+        waited += m_to_write.push(job);
+    }
+
+    qint64 busy = timer.nsecsElapsed() - waited;
+    lastWorker(m_encoding, m_to_write);
+    addBusy(ENCODE, busy);
+}
+
+/**
+ * @brief SFPipeline::write writes the encoded blocks in their order and returns the jobs to the reader
+ *
+ * After a write error the blocks are still taken from the queue (but not written) so no stage blocks.
+ */
+void SFPipeline::write(QIODevice& p_output)
+{
+    QElapsedTimer timer;
+    timer.start();
+    qint64 waited = 0;
+
+    std::map<qint64, Job*> pending;
+    qint64 next = 0;
+    Job* job = 0;
+    for(waited += m_to_write.pop(job); job; waited += m_to_write.pop(job))
+    {
+        pending[job->sequence] = job;
+        for(std::map<qint64, Job*>::iterator it = pending.begin(); it != pending.end() && it->first == next; it = pending.erase(it), next++)
+        {
+            Job* current = it->second;
+            if(!m_failed && p_output.write(current->output) != current->output.size())
+                m_failed = true;
+            m_encoder.commit(current->block);
+            current->block = SFBlockEncoder::Block();       //releases the tables
+            m_items[WRITE]++;
+            waited += m_free.push(current);
+        }
+    }
+    addBusy(WRITE, timer.nsecsElapsed() - waited);
+}
+
+/**
+ * @brief SFPipeline::addBusy adds the time a thread of a stage was working
+ */
+void SFPipeline::addBusy(Stage p_stage, qint64 p_nsecs)
+{
+    m_busy[p_stage] += p_nsecs;
+}
+
+/**
+ * @brief SFPipeline::lastWorker ends a thread of a stage with several threads
+ * @return true if it was the last one, which then tells the next stage that no more jobs follow
+ *
+ * Every thread pushes its jobs before it counts down, so the null job is the last one in p_next.
+ */
+bool SFPipeline::lastWorker(std::atomic<int>& p_running, Queue& p_next)
+{
+    if(--p_running > 0)
+        return false;
+
+    p_next.push(0);
+    return true;
+}
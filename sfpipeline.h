@@ -0,0 +1,97 @@
+#ifndef SFPIPELINE_H
+#define SFPIPELINE_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "sfblockcodec.h"
+#include "sfboundedqueue.h"
+
+/**
+ * \class SFPipeline
+ * @brief Compresses a stream with one thread per stage, so reading and writing overlap with the encoding
+ *
+ * Stages (threads):
+ * read (1)         reads the next block from the input
+ * analyze (N)      counts the symbols and builds the tables of the block (SFBlockEncoder::analyze())
+ * select (1)       picks the table in block order (SFBlockEncoder::select())
+ * encode (N)       writes the block into its own buffer (SFBlockEncoder::write())
+ * write (1)        writes the encoded blocks to the output in block order (SFBlockEncoder::commit())
+ *
+ * The stages are connected by SFBoundedQueues. A block passes through them in a Job that also holds its
+ * input and output buffer. There is a fixed number of jobs: the reader waits for the writer to return
+ * one before it reads the next block, so the memory use does not depend on the size of the input
+ * and a slow output holds back the reading. The output is the same as with SFBlockEncoder::encode().
+ */
+class SFPipeline
+{
+public:
+    /**
+     * @brief The StageStats struct holds how busy a stage was
+     */
+    struct StageStats
+    {
+        QString name;
+        int threads;
+        qint64 items;
+        qint64 busy_nsecs;      //sum over the threads of the stage, without the time waiting for the queues
+    };
+
+    SFPipeline(SFBlockEncoder& p_encoder, int p_block_size, int p_workers);
+
+    bool run(QIODevice& p_input, QIODevice& p_output);
+
+    const QVector<StageStats>& stats() const {return m_stats;}
+    qint64 elapsedNsecs() const {return m_elapsed_nsecs;}
+
+private:
+    Q_DISABLE_COPY(SFPipeline)
+
+    enum Stage {READ, ANALYZE, SELECT, ENCODE, WRITE, STAGES};
+
+    struct Job
+    {
+        qint64 sequence;
+        QByteArray input;
+        QByteArray output;
+        SFBlockEncoder::Block block;
+    };
+    typedef SFBoundedQueue<Job*> Queue;
+
+    void read(QIODevice& p_input);
+    void analyze();
+    void select();
+    void encode();
+    void write(QIODevice& p_output);
+
+    void addBusy(Stage p_stage, qint64 p_nsecs);
+    bool lastWorker(std::atomic<int>& p_running, Queue& p_next);
+
+    SFBlockEncoder& m_encoder;
+    int m_block_size;
+    int m_workers;
+
+    std::vector<Job> m_jobs;
+    Queue m_free;                       //jobs returned by the writer
+    Queue m_to_analyze;
+    Queue m_to_select;
+    Queue m_to_encode;
+    Queue m_to_write;
+    std::atomic<int> m_analyzing;       //analyze and encode threads still running
+    std::atomic<int> m_encoding;
+    std::atomic<bool> m_failed;
+
+    std::atomic<qint64> m_busy[STAGES];
+    std::atomic<qint64> m_items[STAGES];
+    QVector<StageStats> m_stats;
+    qint64 m_elapsed_nsecs;
+};
+
+#endif // SFPIPELINE_H
@@ -0,0 +1,488 @@
+#include "sfserver.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/**
+ * @brief SFProtocol::readFully reads exactly p_size bytes from p_socket
+ * @return false if the connection was closed or failed before
+ */
+bool SFProtocol::readFully(int p_socket, char* p_data, qint64 p_size)
+{
+    while(p_size > 0)
+    {
+        ssize_t bytes = ::recv(p_socket, p_data, size_t(p_size), 0);
+        if(bytes < 0 && errno == EINTR)
+            continue;
+        if(bytes <= 0)
+            return false;
+        p_data += bytes;
+        p_size -= bytes;
+    }
+    return true;
+}
+
+/**
+ * @brief SFProtocol::writeFully writes p_size bytes to p_socket
+ * @return false if the connection was closed or failed
+ *
+ * A closed connection does not raise SIGPIPE.
+ */
+bool SFProtocol::writeFully(int p_socket, const char* p_data, qint64 p_size)
+{
+    while(p_size > 0)
+    {
+        ssize_t bytes = ::send(p_socket, p_data, size_t(p_size), MSG_NOSIGNAL);
+        if(bytes < 0 && errno == EINTR)
+            continue;
+        if(bytes <= 0)
+            return false;
+        p_data += bytes;
+        p_size -= bytes;
+    }
+    return true;
+}
+
+/**
+ * @brief unixAddress fills the address of a socket file
+ * @return false if the path is too long
+ */
+static bool unixAddress(const QString& p_path, sockaddr_un& p_address)
+{
+    QByteArray path = p_path.toLocal8Bit();
+    std::memset(&p_address, 0, sizeof(p_address));
+    p_address.sun_family = AF_UNIX;
+    if(path.size() >= int(sizeof(p_address.sun_path)))
+        return false;
+
+    std::memcpy(p_address.sun_path, path.constData(), size_t(path.size()));
+    return true;
+}
+
+
+SFServer::SFServer():
+    m_socket(-1),
+    m_stopped(false),
+    m_requests(0)
+{
+
+}
+
+SFServer::~SFServer()
+{
+    stop();
+    wait();
+}
+
+/**
+ * @brief SFServer::setModelDirectory sets the directory LOAD_MODEL requests load their model files from
+ * @return false if p_dir is not a directory
+ *
+ * Call it before start(). Without a model directory clients can not load model files.
+ */
+bool SFServer::setModelDirectory(const QString& p_dir)
+{
+    QString dir = QFileInfo(p_dir).canonicalFilePath();
+    if(dir.isEmpty() || !QFileInfo(dir).isDir())
+        return false;
+
+    m_model_dir = dir;
+    return true;
+}
+
+/**
+ * @brief SFServer::addModel loads a model the clients can refer to by its id
+ * @return false if the model can not be loaded or the server holds MAX_MODELS models
+ */
+bool SFServer::addModel(const QString& p_file_name)
+{
+    std::shared_ptr<SFModel> file = std::make_shared<SFModel>();
+    if(!file->load(p_file_name))
+        return false;
+
+    Model model = {file->table(), file};
+    return insertModel(file->id(), model);
+}
+
+/**
+ * @brief SFServer::addTable adds a table built in memory (see SFModel::train())
+ * @return the id of the model or 0 if the server holds MAX_MODELS models
+ *
+ * The decoder lookup table is built before the model is published.
+ */
+quint32 SFServer::addTable(const SFCodeTable& p_table)
+{
+    quint32 id = SFModel::tableId(p_table);
+    Model model = {p_table.withLookup(), std::shared_ptr<SFModel>()};
+    return insertModel(id, model) ? id : 0;
+}
+
+/**
+ * @brief SFServer::insertModel publishes p_model under p_id, replacing a model with the same id
+ * @return false if the server holds MAX_MODELS other models
+ */
+bool SFServer::insertModel(quint32 p_id, const Model& p_model)
+{
+    bool inserted = false;
+    m_models.update([&](Models& p_models)
+    {
+        if(p_models.contains(p_id) || p_models.size() < MAX_MODELS)
+        {
+            p_models.insert(p_id, p_model);
+            inserted = true;
+        }
+    });
+    return inserted;
+}
+
+/**
+ * @brief SFServer::modelPath returns the path of the model file p_name of the model directory
+ * @return an empty string if p_name is not a plain file name or not a regular file of the directory
+ *
+ * Only regular files are accepted, so a client can not make a thread wait on a FIFO or a device.
+ */
+QString SFServer::modelPath(const QString& p_name) const
+{
+    if(m_model_dir.isEmpty() || p_name.isEmpty() || p_name.contains('/') || p_name == "." || p_name == "..")
+        return QString();
+
+    QString path = m_model_dir + "/" + p_name;
+    return QFileInfo(path).isFile() ? path : QString();
+}
+
+/**
+ * @brief SFServer::removeModel removes a model, requests that already use it still finish
+ * @return false if there is no model with the id
+ */
+bool SFServer::removeModel(quint32 p_id)
+{
+    bool found = false;
+    m_models.update([&](Models& p_models) {found = p_models.remove(p_id) > 0;});
+    return found;
+}
+
+/**
+ * @brief SFServer::modelIds returns the ids of the current models
+ * @return an empty list if all readers of the models are taken (see start())
+ */
+QList<quint32> SFServer::modelIds() const
+{
+    ModelPointer::Reader reader(m_models);
+    if(!reader.isValid())
+        return QList<quint32>();
+    ModelPointer::Guard models(reader);
+    return models->keys();
+}
+
+/**
+ * @brief SFServer::listen creates the socket file p_path (replacing an old one) and listens on it
+ * @return false if the socket can not be created
+ */
+bool SFServer::listen(const QString& p_path)
+{
+    sockaddr_un address;
+    if(!unixAddress(p_path, address))
+        return false;
+
+    ::unlink(address.sun_path);
+    m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(m_socket < 0)
+        return false;
+    if(::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+       || ::chmod(address.sun_path, S_IRUSR | S_IWUSR) != 0            //only the owner may connect
+       || ::listen(m_socket, SOMAXCONN) != 0)
+    {
+        ::close(m_socket);
+        m_socket = -1;
+        return false;
+    }
+
+    m_path = p_path;
+    m_stopped = false;
+    return true;
+}
+
+/**
+ * @brief SFServer::start starts p_threads threads that serve the connections
+ *
+ * The threads get their own copy of the listening socket, m_socket is only used by the thread controlling the server.
+ * Every thread holds a reader of the models, so at most MAX_THREADS threads are started. The other
+ * slots of the SFEpochPointer stay free for modelIds().
+ */
+void SFServer::start(int p_threads)
+{
+    static_assert(int(MAX_THREADS) < int(ModelPointer::MAX_READERS), "the threads would take all readers of the models");
+
+    for(int i = 0; i < qBound(1, p_threads, int(MAX_THREADS)); i++)
+        m_threads.push_back(std::thread(&SFServer::serve, this, m_socket));
+}
+
+/**
+ * @brief SFServer::wait waits until all threads ended (after stop())
+ *
+ * The listening socket is closed and its file removed once no thread can use it anymore,
+ * so its descriptor can not be reused while a thread still waits in accept().
+ */
+void SFServer::wait()
+{
+    for(std::thread& thread:m_threads)
+        thread.join();
+    m_threads.clear();
+
+    if(m_stopped && m_socket >= 0)
+    {
+        ::close(m_socket);
+        ::unlink(m_path.toLocal8Bit().constData());
+        m_socket = -1;
+    }
+}
+
+/**
+ * @brief SFServer::stop stops accepting connections, wait() then closes the socket
+ *
+ * Threads that serve a connection end when the client closes it or the connection times out.
+ */
+void SFServer::stop()
+{
+    if(m_socket < 0 || m_stopped.exchange(true))
+        return;
+
+    ::shutdown(m_socket, SHUT_RDWR);     //wakes the threads waiting in accept()
+}
+
+/**
+ * @brief SFServer::handle answers a single request
+ * @param p_reader the reader of the calling thread
+ * @param p_operation a SFProtocol::Operation
+ * @param p_model id of the model or 0
+ * @param p_payload the data to compress or decompress
+ * @param p_response is set to the result
+ * @return a SFProtocol::Status
+ *
+ * Called by all threads at the same time. Compressing and decompressing only read the models.
+ */
+quint8 SFServer::handle(ModelPointer::Reader& p_reader, quint8 p_operation, quint32 p_model, const QByteArray& p_payload, QByteArray& p_response)
+{
+    p_response.resize(0);
+
+    if(p_operation == SFProtocol::LOAD_MODEL)
+    {
+        QString path = modelPath(QString::fromLocal8Bit(p_payload));
+        std::shared_ptr<SFModel> file = std::make_shared<SFModel>();
+        if(path.isEmpty() || !file->load(path))
+            return SFProtocol::MODEL_FAILED;
+        Model model = {file->table(), file};
+        if(!insertModel(file->id(), model))
+            return SFProtocol::MODEL_FAILED;
+        return addedModel(file->id(), p_response);
+    }
+    if(p_operation == SFProtocol::TRAIN_MODEL)
+    {
+        if(p_payload.isEmpty())
+            return SFProtocol::MODEL_FAILED;
+        quint32 id = addTable(SFModel::train(SFCodeTable::histogram(p_payload.constData(), p_payload.size())));
+        if(id == 0)
+            return SFProtocol::MODEL_FAILED;
+        return addedModel(id, p_response);
+    }
+    if(p_operation == SFProtocol::DROP_MODEL)
+        return removeModel(p_model) ? SFProtocol::OK : SFProtocol::UNKNOWN_MODEL;
+
+    ModelPointer::Guard models(p_reader);     //keeps the set and the mapped files of its models until the request is answered
+    SFCodeTable model(0);
+    if(p_model != 0)
+    {
+        Models::const_iterator it = models->find(p_model);
+        if(it == models->end())
+            return SFProtocol::UNKNOWN_MODEL;
+        model = it.value().table;
+    }
+
+    if(p_operation == SFProtocol::COMPRESS)
+    {
+        SFBlockEncoder encoder;
+        if(!model.isEmpty())
+            encoder.setModel(model);
+        for(int pos = 0; pos < p_payload.size(); pos += SFBlockEncoder::DEFAULT_BLOCK_SIZE)
+            encoder.encodeBlock(p_payload.constData() + pos, qMin(int(SFBlockEncoder::DEFAULT_BLOCK_SIZE), p_payload.size() - pos), p_response);
+        if(quint32(p_response.size()) > SFProtocol::MAX_PAYLOAD)     //the client would not accept it
+        {
+            p_response.resize(0);
+            return SFProtocol::TOO_LARGE;
+        }
+        return SFProtocol::OK;
+    }
+
+    if(p_operation == SFProtocol::DECOMPRESS)
+    {
+        qint64 size = SFBlockDecoder::decodedSize(p_payload.constData(), p_payload.size());
+        if(size < 0)
+            return SFProtocol::CORRUPTED;
+        if(size > SFProtocol::MAX_PAYLOAD)
+            return SFProtocol::TOO_LARGE;
+
+        SFBlockDecoder decoder;
+        if(!model.isEmpty())
+            decoder.setModel(model);
+        p_response.resize(int(size));
+        if(decoder.decode(p_payload.constData(), p_payload.size(), p_response.data(), size) != size)
+        {
+            p_response.resize(0);
+            return SFProtocol::CORRUPTED;
+        }
+        return SFProtocol::OK;
+    }
+    return SFProtocol::BAD_REQUEST;
+}
+
+/**
+ * @brief SFServer::addedModel writes the id of a new model into the response
+ */
+quint8 SFServer::addedModel(quint32 p_id, QByteArray& p_response) const
+{
+    p_response.resize(4);
+    qToBigEndian<quint32>(p_id, reinterpret_cast<uchar*>(p_response.data()));
+    return SFProtocol::OK;
+}
+
+/**
+ * @brief SFServer::serve is the loop of a thread of the pool
+ * @param p_listener the listening socket
+ */
+void SFServer::serve(int p_listener)
+{
+    while(!m_stopped)
+    {
+        int socket = ::accept(p_listener, 0, 0);
+        if(socket < 0)
+        {
+            if(errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return;
+        }
+        timeval timeout = {SFProtocol::IDLE_TIMEOUT_SECONDS, 0};     //recv() and send() fail if the client does not go on
+        ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serveConnection(socket);
+        ::close(socket);
+    }
+}
+
+/**
+ * @brief SFServer::serveConnection answers the requests of a connection until the client closes it
+ *
+ * The buffers are reused for all requests of the connection. A request with a payload larger than
+ * SFProtocol::MAX_PAYLOAD is answered with BAD_REQUEST without reading the payload, and the connection
+ * is closed: the rest of the stream can not be told apart from the next request.
+ */
+void SFServer::serveConnection(int p_socket)
+{
+    ModelPointer::Reader reader(m_models);
+    if(!reader.isValid())
+        return;
+    QByteArray payload, response;
+    uchar header[SFProtocol::HEADER_BYTES];
+    while(SFProtocol::readFully(p_socket, reinterpret_cast<char*>(header), sizeof(header)))
+    {
+        quint32 model = qFromBigEndian<quint32>(header + 1);
+        quint32 size = qFromBigEndian<quint32>(header + 5);
+        uchar answer[SFProtocol::RESPONSE_HEADER_BYTES];
+        if(size > SFProtocol::MAX_PAYLOAD)
+        {
+            ::shutdown(p_socket, SHUT_RD);      //nothing else of this connection is read
+            answer[0] = SFProtocol::BAD_REQUEST;
+            qToBigEndian<quint32>(0, answer + 1);
+            SFProtocol::writeFully(p_socket, reinterpret_cast<const char*>(answer), sizeof(answer));
+            m_requests++;
+            return;
+        }
+
+        payload.resize(int(size));
+        if(!SFProtocol::readFully(p_socket, payload.data(), size))
+            return;
+        quint8 status = handle(reader, header[0], model, payload, response);
+        if(status != SFProtocol::OK)
+            response.resize(0);
+
+        answer[0] = status;
+        qToBigEndian<quint32>(quint32(response.size()), answer + 1);
+        if(!SFProtocol::writeFully(p_socket, reinterpret_cast<const char*>(answer), sizeof(answer))
+           || !SFProtocol::writeFully(p_socket, response.constData(), response.size()))
+            return;
+        m_requests++;
+    }
+}
+
+SFClient::SFClient():
+    m_socket(-1)
+{
+
+}
+
+SFClient::~SFClient()
+{
+    if(m_socket >= 0)
+        ::close(m_socket);
+}
+
+/**
+ * @brief SFClient::connect connects to the server listening on p_path
+ */
+bool SFClient::connect(const QString& p_path)
+{
+    sockaddr_un address;
+    if(!unixAddress(p_path, address))
+        return false;
+
+    m_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if(m_socket >= 0 && ::connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+        return true;
+
+    if(m_socket >= 0)
+        ::close(m_socket);
+    m_socket = -1;
+    return false;
+}
+
+/**
+ * @brief SFClient::request sends a request and waits for the response
+ * @param p_response is set to the payload of the response
+ * @return the status of the response (SFProtocol::Status) or -1 if the connection failed
+ *
+ * The header and the payload are sent with one call. Payloads larger than SFProtocol::MAX_PAYLOAD are
+ * not sent. If the connection fails it is closed, because the rest of a response can not be skipped.
+ */
+int SFClient::request(quint8 p_operation, quint32 p_model, const QByteArray& p_payload, QByteArray& p_response)
+{
+    if(m_socket < 0 || quint32(p_payload.size()) > SFProtocol::MAX_PAYLOAD)
+        return -1;
+
+    m_buffer.resize(SFProtocol::HEADER_BYTES);
+    uchar* header = reinterpret_cast<uchar*>(m_buffer.data());
+    header[0] = p_operation;
+    qToBigEndian<quint32>(p_model, header + 1);
+    qToBigEndian<quint32>(quint32(p_payload.size()), header + 5);
+    m_buffer.append(p_payload);
+    uchar answer[SFProtocol::RESPONSE_HEADER_BYTES];
+    quint32 size = 0;
+    if(SFProtocol::writeFully(m_socket, m_buffer.constData(), m_buffer.size())
+       && SFProtocol::readFully(m_socket, reinterpret_cast<char*>(answer), sizeof(answer))
+       && (size = qFromBigEndian<quint32>(answer + 1)) <= SFProtocol::MAX_PAYLOAD)
+    {
+        p_response.resize(int(size));
+        if(SFProtocol::readFully(m_socket, p_response.data(), size))
+            return answer[0];
+    }
+
+    ::close(m_socket);
+    m_socket = -1;
+    return -1;
+}
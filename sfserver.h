@@ -0,0 +1,143 @@
+#ifndef SFSERVER_H
+#define SFSERVER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "sfblockcodec.h"
+#include "sfepochpointer.h"
+#include "sfmodel.h"
+
+/**
+ * @brief The SFProtocol namespace describes the messages between SFServer and SFClient
+ *
+ * Request:  operation (8 bits), model id (32 bits, 0 = no model), payload size (32 bits), payload
+ * Response: status (8 bits), payload size (32 bits), payload
+ *
+ * COMPRESS and DECOMPRESS answer with the result, or with TOO_LARGE and no payload if the result would
+ * be larger than MAX_PAYLOAD (incompressible blocks grow by their header). LOAD_MODEL loads the model file named by the payload
+ * from the model directory of the server (a plain file name, see SFServer::setModelDirectory()),
+ * TRAIN_MODEL trains a model from the payload (a sample of the data), both answer with the id of the
+ * new model (32 bits) or with MODEL_FAILED, also if the server already holds SFServer::MAX_MODELS models.
+ * DROP_MODEL removes the model of the request.
+ *
+ * All numbers are big endian. A connection can carry any number of requests, each request is
+ * answered before the next one is read. A request with a payload larger than MAX_PAYLOAD is answered
+ * with BAD_REQUEST and the server closes the connection. The server also closes a connection on which
+ * nothing arrived (or nothing could be sent) for IDLE_TIMEOUT_SECONDS. Compressed payloads are blocks of SFBlockEncoder.
+ */
+namespace SFProtocol
+{
+    enum Operation {COMPRESS = 'C', DECOMPRESS = 'D', LOAD_MODEL = 'L', TRAIN_MODEL = 'T', DROP_MODEL = 'X'};
+    enum Status {OK = 0, UNKNOWN_MODEL = 1, CORRUPTED = 2, BAD_REQUEST = 3, MODEL_FAILED = 4, TOO_LARGE = 5};
+    static const int HEADER_BYTES = 9;
+    static const int RESPONSE_HEADER_BYTES = 5;
+    static const quint32 MAX_PAYLOAD = 64 << 20;
+    static const int IDLE_TIMEOUT_SECONDS = 30;
+
+    bool readFully(int p_socket, char* p_data, qint64 p_size);
+    bool writeFully(int p_socket, const char* p_data, qint64 p_size);
+}
+
+/**
+ * \class SFServer
+ * @brief Compresses and decompresses payloads sent over a Unix domain socket
+ *
+ * The models are loaded once and their code tables and decoder lookup tables are shared (read only)
+ * by all threads, so a request only encodes or decodes its payload. Payloads without a model get
+ * their own table.
+ *
+ * Models can be added and removed while the server runs. The set of models is immutable, a change
+ * publishes a changed copy through a SFEpochPointer. Requests keep using the set they started with and
+ * never wait for a change, the old set is deleted when no request uses it anymore. The server holds at
+ * most MAX_MODELS models. Clients can only load model files from the model directory, without one
+ * LOAD_MODEL fails. The socket file can only be used by the user running the server (mode 0600).
+ *
+ * A pool of threads accepts the connections. Every thread serves one connection at a time
+ * until the client closes it, further connections wait in the backlog of the socket. So at most one
+ * client per thread is served at the same time: clients should close connections they do not use,
+ * an idle connection holds its thread for up to SFProtocol::IDLE_TIMEOUT_SECONDS before it is closed.
+ * Every thread holds a reader slot of the SFEpochPointer (it has MAX_READERS), so the pool has at
+ * most MAX_THREADS threads.
+ */
+class SFServer
+{
+public:
+    enum {MAX_MODELS = 256, MAX_THREADS = 128};
+
+    SFServer();
+    ~SFServer();
+
+    bool setModelDirectory(const QString& p_dir);
+    bool addModel(const QString& p_file_name);
+    quint32 addTable(const SFCodeTable& p_table);
+    bool removeModel(quint32 p_id);
+    QList<quint32> modelIds() const;
+    quint64 modelsVersion() const {return m_models.version();}
+
+    bool listen(const QString& p_path);
+    void start(int p_threads);
+    void wait();
+    void stop();
+
+    qint64 requests() const {return m_requests;}
+
+private:
+    Q_DISABLE_COPY(SFServer)
+
+    /**
+     * @brief The Model struct is a table of the model set
+     */
+    struct Model
+    {
+        SFCodeTable table;
+        std::shared_ptr<SFModel> file;      //keeps the mapped file of a loaded model
+    };
+    typedef QMap<quint32, Model> Models;    //model id -> model
+    typedef SFEpochPointer<Models> ModelPointer;
+
+    void serve(int p_listener);
+    void serveConnection(int p_socket);
+    quint8 handle(ModelPointer::Reader& p_reader, quint8 p_operation, quint32 p_model, const QByteArray& p_payload, QByteArray& p_response);
+    quint8 addedModel(quint32 p_id, QByteArray& p_response) const;
+    bool insertModel(quint32 p_id, const Model& p_model);
+    QString modelPath(const QString& p_name) const;
+
+    mutable ModelPointer m_models;
+    QString m_path;
+    QString m_model_dir;                    //LOAD_MODEL only loads files from here, empty = not at all
+    int m_socket;                           //the listening socket, closed by wait()
+    std::atomic<bool> m_stopped;
+    std::atomic<qint64> m_requests;
+    std::vector<std::thread> m_threads;
+};
+
+/**
+ * \class SFClient
+ * @brief Sends requests to a SFServer
+ */
+class SFClient
+{
+public:
+    SFClient();
+    ~SFClient();
+
+    bool connect(const QString& p_path);
+    int request(quint8 p_operation, quint32 p_model, const QByteArray& p_payload, QByteArray& p_response);  //returns the status or -1 if the connection failed
+
+private:
+    Q_DISABLE_COPY(SFClient)
+
+    int m_socket;                           //the listening socket, closed by wait()
+    QByteArray m_buffer;
+};
+
+#endif // SFSERVER_H
@@ -0,0 +1,387 @@
+#ifndef SFSTATICCODEC_H
+#define SFSTATICCODEC_H
+
+#include <QtGlobal>
+
+#include "sfbitstream.h"
+#include "sfcodetable.h"
+
+/**
+ * @brief The SFStaticCodes struct is a code table that is built at compile time
+ *
+ * sfStaticCodes() assigns the codes with the same integer split as SFList::assignCodes() (the
+ * "shannon-fano" builder), so the codes are exactly the ones SFCodeTable::fromHistogram() would build
+ * at runtime for the same counts.
+ */
+template<int N>
+struct SFStaticCodes
+{
+    constexpr SFStaticCodes(): bits(), length(), order(), symbols(0) {}
+
+    constexpr int maxLength() const
+    {
+        int result = 0;
+        for(int i = 0; i < N; i++)
+            result = length[i] > result ? length[i] : result;
+        return result;
+    }
+
+    quint64 bits[N];    //code of every symbol (right aligned)
+    int length[N];      //0 if the symbol has no code
+    int order[N];       //symbols sorted by their codes
+    int symbols;        //number of symbols with a code
+};
+
+/**
+ * @brief The SFStaticLookup struct maps the next BITS bits of the input to (symbol << 8 | length), 0 for invalid codes
+ *
+ * BITS is the length of the longest code so every symbol is decoded with a single lookup.
+ */
+template<int BITS>
+struct SFStaticLookup
+{
+    constexpr SFStaticLookup(): entry() {}
+
+    quint32 entry[1 << BITS];
+};
+
+/**
+ * @brief sfStaticSplit is SFList::split() on prefix sums
+ * @return position (relative to p_first) where the range [p_first, p_last) is split
+ */
+constexpr int sfStaticSplit(const qint64* p_prefix, int p_first, int p_last)
+{
+    int size = p_last - p_first;
+    qint64 first = p_prefix[p_first];
+    qint64 total = p_prefix[p_last] - first;
+
+    int pos = 1;                                            //first position at or to the right of the best balance
+    while(pos < size && 2*(p_prefix[p_first + pos] - first) < total)
+        pos++;
+
+    qint64 left = p_prefix[p_first + pos] - first;
+    qint64 left_before = p_prefix[p_first + pos - 1] - first;
+    if((2*left - total) > (total - 2*left_before))
+        pos--;
+
+    return pos < 1 ? 1 : (pos > size - 1 ? size - 1 : pos);
+}
+
+/**
+ * @brief sfStaticAssign is SFList::assignCodesHelper() on the sorted symbols p_sorted[p_first, p_last)
+ */
+template<int N>
+constexpr void sfStaticAssign(SFStaticCodes<N>& p_codes, const int* p_sorted, const qint64* p_prefix, int p_first, int p_last)
+{
+    int mid = p_last - p_first < 2 ? p_last : p_first + sfStaticSplit(p_prefix, p_first, p_last);
+
+    for(int i = p_first; i < p_last; i++)
+    {
+        int sym = p_sorted[i];
+        p_codes.bits[sym] = (p_codes.bits[sym] << 1) | (i < mid ? 0 : 1);
+        p_codes.length[sym]++;
+    }
+
+    if(mid - p_first > 1)
+        sfStaticAssign(p_codes, p_sorted, p_prefix, p_first, mid);
+    if(p_last - mid > 1)
+        sfStaticAssign(p_codes, p_sorted, p_prefix, mid, p_last);
+}
+
+/**
+ * @brief sfStaticCodes builds the code table of a histogram at compile time
+ * @param p_counts number of occurences of every symbol (index = symbol), symbols with count 0 get no code
+ * @return SFStaticCodes with the codes SFCodeTable::fromHistogram() builds with the default builder
+ *
+ * The counts are scaled down like in SFCodeTable::fromHistogram() and sorted like SFList::sortByCount()
+ * (highest count first, equal counts by symbol value).
+ */
+template<int N>
+constexpr SFStaticCodes<N> sfStaticCodes(const quint64 (&p_counts)[N])
+{
+    SFStaticCodes<N> codes;
+
+    quint64 total = 0;
+    for(int i = 0; i < N; i++)
+        total += p_counts[i];
+    quint64 divisor = 1;
+    while(total/divisor > 0x7FFFFFFF)
+        divisor *= 2;
+
+    int sorted[N] = {};
+    qint64 count[N] = {};
+    for(int i = 0; i < N; i++)
+    {
+        if(p_counts[i] == 0)
+            continue;
+
+        qint64 scaled = qint64(p_counts[i]/divisor > 0 ? p_counts[i]/divisor : 1);
+        int pos = codes.symbols++;
+        while(pos > 0 && count[pos-1] < scaled)         //insertion sort, symbols are visited in ascending order
+        {
+            sorted[pos] = sorted[pos-1];
+            count[pos] = count[pos-1];
+            pos--;
+        }
+        sorted[pos] = i;
+        count[pos] = scaled;
+    }
+
+    qint64 prefix[N+1] = {};
+    for(int i = 0; i < codes.symbols; i++)
+        prefix[i+1] = prefix[i] + count[i];
+
+    if(codes.symbols > 0)
+        sfStaticAssign(codes, sorted, prefix, 0, codes.symbols);
+    for(int i = 0; i < codes.symbols; i++)          //the split keeps the symbols in the order of their codes
+        codes.order[i] = sorted[i];
+    return codes;
+}
+
+/**
+ * @brief sfStaticLookup fills the lookup table of p_codes
+ */
+template<int BITS, int N>
+constexpr SFStaticLookup<BITS> sfStaticLookup(const SFStaticCodes<N>& p_codes)
+{
+    SFStaticLookup<BITS> lookup;
+    for(int sym = 0; sym < N; sym++)
+    {
+        int length = p_codes.length[sym];
+        if(length == 0)
+            continue;
+
+        quint32 first = quint32(p_codes.bits[sym] << (BITS - length));
+        for(quint32 i = 0; i < (quint32(1) << (BITS - length)); i++)
+            lookup.entry[first + i] = quint32(sym) << 8 | quint32(length);
+    }
+    return lookup;
+}
+
+/**
+ * @brief sfStaticDecodable checks that p_lookup decodes every code of p_codes to its symbol
+ *
+ * Entries that belong to two codes keep only the later one, so this also fails if the codes are not prefix free.
+ */
+template<int BITS, int N>
+constexpr bool sfStaticDecodable(const SFStaticCodes<N>& p_codes, const SFStaticLookup<BITS>& p_lookup)
+{
+    int symbols = 0;
+    for(int sym = 0; sym < N; sym++)
+    {
+        int length = p_codes.length[sym];
+        if(length == 0)
+            continue;
+        if(length > BITS)
+            return false;
+
+        symbols++;
+        quint32 first = quint32(p_codes.bits[sym] << (BITS - length));
+        for(quint32 i = 0; i < (quint32(1) << (BITS - length)); i++)
+        {
+            if(p_lookup.entry[first + i] != (quint32(sym) << 8 | quint32(length)))
+                return false;
+        }
+    }
+    return symbols == p_codes.symbols;
+}
+
+/**
+ * @brief SFStaticUnroll calls f(I), f(I+1), ..., f(N-1) without a loop
+ */
+template<int I, int N>
+struct SFStaticUnroll
+{
+    template<class F>
+    static void run(F& f) {f(I); SFStaticUnroll<I+1, N>::run(f);}
+};
+
+template<int N>
+struct SFStaticUnroll<N, N>
+{
+    template<class F>
+    static void run(F&) {}
+};
+
+/**
+ * \class SFStaticCodec
+ * @brief Encoder and decoder for data with a fixed, known distribution
+ *
+ * Model has to provide the histogram as `static constexpr quint64 counts[]` (index = symbol). The
+ * code table and the decode lookup table are constants, nothing is built at runtime. The lookup
+ * table covers the longest code, so every symbol is decoded with one lookup. The buffer functions
+ * pack several codes into one writeBits() call and decode several symbols from one peekBits() window,
+ * those inner loops are unrolled by SFStaticUnroll.
+ *
+ * The output is the same as encoding the data symbol by symbol with
+ * SFCodeTable::fromHistogram(Model::counts), but no table is written. Every instantiation checks at
+ * compile time that the lookup table decodes every code, check() compares the codes with the runtime
+ * table and round-trips the symbols of the model (see SFTelemetryCodec and sfc bench).
+ */
+template<class Model>
+class SFStaticCodec
+{
+public:
+    static const int ALPHABET_SIZE = int(sizeof(Model::counts)/sizeof(Model::counts[0]));
+    static const int MAX_LOOKUP_BITS = 12;
+    static constexpr SFStaticCodes<ALPHABET_SIZE> CODES = sfStaticCodes(Model::counts);
+    static constexpr int LOOKUP_BITS = CODES.maxLength() > 0 ? CODES.maxLength() : 1;
+    static constexpr SFStaticLookup<LOOKUP_BITS> LOOKUP = sfStaticLookup<LOOKUP_BITS>(CODES);
+
+    static_assert(LOOKUP_BITS <= MAX_LOOKUP_BITS, "the longest code of the model is too long for a static lookup table");
+    static_assert(sfStaticDecodable(CODES, LOOKUP), "the lookup table does not decode every code of the model");
+
+    static void encode(SFBitWriter& p_writer, int p_symbol) {p_writer.writeBits(CODES.bits[p_symbol], CODES.length[p_symbol]);}
+    static inline int decode(SFBitReader& p_reader);
+
+    static bool encode(const uchar* p_data, qint64 p_size, SFBitWriter& p_writer);
+    static qint64 decode(SFBitReader& p_reader, uchar* p_out, qint64 p_count);
+
+    static bool check();
+
+private:
+    static const int SYMBOLS_PER_WRITE = 32/LOOKUP_BITS;    //codes packed into one writeBits() call
+    static const int SYMBOLS_PER_PEEK = 57/LOOKUP_BITS;     //symbols decoded from one peekBits() window
+};
+
+template<class Model> constexpr SFStaticCodes<SFStaticCodec<Model>::ALPHABET_SIZE> SFStaticCodec<Model>::CODES;
+template<class Model> constexpr int SFStaticCodec<Model>::LOOKUP_BITS;
+template<class Model> constexpr SFStaticLookup<SFStaticCodec<Model>::LOOKUP_BITS> SFStaticCodec<Model>::LOOKUP;
+
+/**
+ * @brief SFStaticCodec::decode reads one code from p_reader
+ * @return the decoded symbol or -1 if the reader ran out of bits or the code is unknown
+ */
+template<class Model>
+inline int SFStaticCodec<Model>::decode(SFBitReader& p_reader)
+{
+    quint32 entry = LOOKUP.entry[p_reader.peekBits(LOOKUP_BITS)];
+    int length = int(entry & 0xFF);
+    if(length == 0 || length > p_reader.bitsLeft())
+        return -1;
+
+    p_reader.skipBits(length);
+    return int(entry >> 8);
+}
+
+/**
+ * @brief SFStaticCodec::encode encodes a buffer
+ * @param p_data the symbols (all below ALPHABET_SIZE)
+ * @param p_size number of symbols
+ * @param p_writer SFBitWriter the codes are appended to
+ * @return false if the data contains a symbol without code (nothing is written from that symbol on)
+ */
+template<class Model>
+bool SFStaticCodec<Model>::encode(const uchar* p_data, qint64 p_size, SFBitWriter& p_writer)
+{
+    bool result = true;
+    for(qint64 i = 0; i < p_size; i++)
+    {
+        if(p_data[i] >= ALPHABET_SIZE || CODES.length[p_data[i]] == 0)
+        {
+            p_size = i;
+            result = false;
+            break;
+        }
+    }
+
+    qint64 pos = 0;
+    for(; pos + SYMBOLS_PER_WRITE <= p_size; pos += SYMBOLS_PER_WRITE)
+    {
+        quint64 word = 0;
+        int length = 0;
+        const uchar* data = p_data + pos;
+        auto pack = [&](int j) {word = (word << CODES.length[data[j]]) | CODES.bits[data[j]]; length += CODES.length[data[j]];};
+        SFStaticUnroll<0, SYMBOLS_PER_WRITE>::run(pack);
+        p_writer.writeBits(word, length);
+    }
+    for(; pos < p_size; pos++)
+        encode(p_writer, p_data[pos]);
+    return result;
+}
+
+/**
+ * @brief SFStaticCodec::decode decodes p_count symbols
+ * @param p_reader SFBitReader positioned at the first code
+ * @param p_out buffer for at least p_count symbols
+ * @param p_count number of symbols to decode
+ * @return number of decoded symbols or -1 if the data is corrupted
+ */
+template<class Model>
+qint64 SFStaticCodec<Model>::decode(SFBitReader& p_reader, uchar* p_out, qint64 p_count)
+{
+    const quint64 mask = (quint64(1) << LOOKUP_BITS) - 1;
+    qint64 pos = 0;
+    while(pos + SYMBOLS_PER_PEEK <= p_count && p_reader.bitsLeft() >= 57)
+    {
+        quint64 window = p_reader.peekBits(57);
+        int used = 0;
+        bool invalid = false;
+        uchar* out = p_out + pos;
+        auto step = [&](int j) {
+            quint32 entry = LOOKUP.entry[(window >> (57 - LOOKUP_BITS - used)) & mask];
+            out[j] = uchar(entry >> 8);
+            used += int(entry & 0xFF);
+            invalid |= entry == 0;
+        };
+        SFStaticUnroll<0, SYMBOLS_PER_PEEK>::run(step);
+        if(invalid)
+            return -1;
+
+        p_reader.skipBits(used);
+        pos += SYMBOLS_PER_PEEK;
+    }
+    for(; pos < p_count; pos++)
+    {
+        int sym = decode(p_reader);
+        if(sym < 0)
+            return -1;
+        p_out[pos] = uchar(sym);
+    }
+    return pos;
+}
+
+/**
+ * @brief SFStaticCodec::check compares CODES with the table SFCodeTable::fromHistogram() builds for the counts
+ * of the model and encodes and decodes all symbols of the model with the buffer functions
+ * @return false if a code differs from the runtime table or the symbols do not survive the round trip
+ */
+template<class Model>
+bool SFStaticCodec<Model>::check()
+{
+    QVector<quint64> histogram(ALPHABET_SIZE, 0);
+    for(int sym = 0; sym < ALPHABET_SIZE; sym++)
+        histogram[sym] = Model::counts[sym];
+    SFCodeTable table = SFCodeTable::fromHistogram(histogram);
+
+    QByteArray data;
+    for(int sym = 0; sym < ALPHABET_SIZE; sym++)
+    {
+        const SFCode& code = table.code(sym);
+        if(code.length != CODES.length[sym] || (code.length > 0 && code.bits != CODES.bits[sym]))
+            return false;
+        if(code.length > 0)
+            data.append(char(sym));
+    }
+    while(data.size() < 4*SYMBOLS_PER_PEEK)     //long enough for the unrolled loops
+        data += data;
+    if(data.isEmpty())
+        return true;
+
+    QByteArray expected, encoded;
+    SFBitWriter table_writer(&expected), writer(&encoded);
+    for(char sym:data)
+        table.encode(table_writer, uchar(sym));
+    table_writer.flush();
+    if(!encode(reinterpret_cast<const uchar*>(data.constData()), data.size(), writer))
+        return false;
+    writer.flush();
+
+    QByteArray decoded(data.size(), '\0');
+    SFBitReader reader(encoded);
+    return encoded == expected
+           && decode(reader, reinterpret_cast<uchar*>(decoded.data()), decoded.size()) == decoded.size()
+           && decoded == data;
+}
+
+#endif // SFSTATICCODEC_H
@@ -0,0 +1,124 @@
+#include "sftaskpool.h"
+
+#include <chrono>
+#include <thread>
+
+static thread_local SFTaskPool* t_pool = 0;     //pool and deque of the current thread
+static thread_local int t_worker = -1;
+
+/**
+ * @brief SFTaskPool::SFTaskPool creates a pool with p_threads threads (started by run())
+ */
+SFTaskPool::SFTaskPool(int p_threads):
+    m_stats(size_t(qMax(p_threads, 1))),
+    m_pending(0),
+    m_next(0)
+{
+    for(int i = 0; i < qMax(p_threads, 1); i++)
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker()));
+}
+
+/**
+ * @brief SFTaskPool::spawn adds a task
+ *
+ * Called by a task it goes to the deque of the thread running it, otherwise the tasks are
+ * distributed round-robin.
+ */
+void SFTaskPool::spawn(const Task& p_task)
+{
+    int index = (t_pool == this) ? t_worker : m_next++ % threads();
+    m_pending++;
+
+    Worker& worker = *m_workers[size_t(index)];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(p_task);
+}
+
+/**
+ * @brief SFTaskPool::run runs all tasks and returns when they and the tasks they spawned are done
+ */
+void SFTaskPool::run()
+{
+    for(ThreadStats& stats:m_stats)
+        stats = ThreadStats{0, 0, 0};
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < this->threads(); i++)
+        threads.push_back(std::thread(&SFTaskPool::work, this, i));
+    for(std::thread& thread:threads)
+        thread.join();
+}
+
+/**
+ * @brief SFTaskPool::work is the loop of a thread of the pool
+ *
+ * A thread that finds no task waits a little longer every round (like SFBoundedQueue) since a
+ * running task may still spawn more. It ends when no task is left anywhere.
+ */
+void SFTaskPool::work(int p_index)
+{
+    t_pool = this;
+    t_worker = p_index;
+    ThreadStats& stats = m_stats[size_t(p_index)];
+
+    int round = 0;
+    while(m_pending > 0)
+    {
+        Task task;
+        bool stolen = false;
+        if(!take(p_index, task, stolen))
+        {
+            if(round < 16)
+                std::this_thread::yield();
+            else
+                std::this_thread::sleep_for(std::chrono::microseconds(round < 64 ? 5 : 50));
+            round++;
+            continue;
+        }
+        round = 0;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        task();
+        stats.busy_nsecs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        stats.tasks++;
+        stats.stolen += stolen;
+        m_pending--;        //after the task, so its spawned tasks are counted before
+    }
+
+    t_pool = 0;
+    t_worker = -1;
+}
+
+/**
+ * @brief SFTaskPool::take takes the newest task of the own deque or the oldest one of another
+ * @param p_stolen is set to true if the task came from another deque
+ * @return false if all deques are empty
+ */
+bool SFTaskPool::take(int p_index, Task& p_task, bool& p_stolen)
+{
+    {
+        Worker& own = *m_workers[size_t(p_index)];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if(!own.tasks.empty())
+        {
+            p_task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            p_stolen = false;
+            return true;
+        }
+    }
+
+    for(int i = 1; i < threads(); i++)
+    {
+        Worker& victim = *m_workers[size_t((p_index + i) % threads())];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if(!victim.tasks.empty())
+        {
+            p_task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            p_stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,67 @@
+#ifndef SFTASKPOOL_H
+#define SFTASKPOOL_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * \class SFTaskPool
+ * @brief Runs tasks that spawn further tasks on a fixed number of threads with work stealing
+ *
+ * Every thread has its own deque of tasks. Tasks spawned by a task go to the back of the deque of
+ * its thread, which also takes its next task from the back, so a thread keeps working on the
+ * newest (smallest, cache warm) tasks of what it started. A thread whose deque is empty steals the
+ * oldest task from the front of another deque, those are the big ones that spawn more work. The
+ * deques are short lived and only touched twice per task, so each has a plain mutex.
+ *
+ * run() starts the threads and returns when all tasks, including the ones spawned while running,
+ * are done.
+ */
+class SFTaskPool
+{
+public:
+    typedef std::function<void()> Task;
+
+    /**
+     * @brief The ThreadStats struct holds what a thread of the pool did
+     */
+    struct ThreadStats
+    {
+        qint64 tasks;
+        qint64 stolen;          //tasks taken from other threads
+        qint64 busy_nsecs;
+    };
+
+    explicit SFTaskPool(int p_threads);
+
+    void spawn(const Task& p_task);
+    void run();
+
+    int threads() const {return int(m_workers.size());}
+    const std::vector<ThreadStats>& stats() const {return m_stats;}
+
+private:
+    Q_DISABLE_COPY(SFTaskPool)
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void work(int p_index);
+    bool take(int p_index, Task& p_task, bool& p_stolen);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<ThreadStats> m_stats;
+    std::atomic<qint64> m_pending;      //spawned tasks that did not finish yet
+    int m_next;                         //deque for the next task spawned outside the pool
+};
+
+#endif // SFTASKPOOL_H
@@ -0,0 +1,3 @@
+#include "sftelemetry.h"
+
+constexpr quint64 SFTelemetryDigits::counts[58];
@@ -0,0 +1,343 @@
+#include "sftokencodec.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+static const int MIN_TOKEN_COUNT = 4;       //tokens used less often in the sample do not pay for themselves
+
+static bool isLetter(uchar p_byte)
+{
+    return (p_byte >= 'a' && p_byte <= 'z') || (p_byte >= 'A' && p_byte <= 'Z');
+}
+
+SFTokenAlphabet::SFTokenAlphabet()
+{
+    for(int byte = 0; byte < BYTES; byte++)
+    {
+        char c = char(byte);
+        addToken(&c, 1);
+    }
+    index();
+}
+
+/**
+ * @brief SFTokenAlphabet::build picks the tokens for an input
+ * @param p_data the input, only the first SAMPLE_SIZE bytes are counted
+ * @param p_max_tokens maximum number of tokens besides the bytes
+ *
+ * The candidates are ranked by the number of symbols they save if every occurence was replaced.
+ * Since tokens overlap (a digram inside a chosen word) the sample is tokenized once with the chosen
+ * tokens and the ones that are still used less than MIN_TOKEN_COUNT times are dropped.
+ */
+SFTokenAlphabet SFTokenAlphabet::build(const char* p_data, qint64 p_size, int p_max_tokens)
+{
+    const uchar* data = reinterpret_cast<const uchar*>(p_data);
+    qint64 size = qMin(p_size, qint64(SAMPLE_SIZE));
+
+    std::vector<quint32> digrams(1 << 16, 0);
+    QHash<quint32, quint32> trigrams;
+    QHash<QByteArray, quint32> words;
+    for(qint64 i = 0; i + 1 < size; i++)
+    {
+        digrams[(data[i] << 8) | data[i+1]]++;
+        if(i + 2 < size)
+            trigrams[(quint32(data[i]) << 16) | (quint32(data[i+1]) << 8) | data[i+2]]++;
+    }
+    for(qint64 i = 0; i < size; )
+    {
+        if(!isLetter(data[i]))
+        {
+            i++;
+            continue;
+        }
+        qint64 begin = (i > 0 && data[i-1] == ' ') ? i - 1 : i;
+        while(i < size && isLetter(data[i]))
+            i++;
+        if(i - begin > 3 && i - begin <= MAX_TOKEN_LENGTH)     //shorter ones are trigrams or digrams
+            words[QByteArray(p_data + begin, int(i - begin))]++;
+    }
+
+    struct Candidate
+    {
+        QByteArray bytes;
+        quint64 score;
+    };
+    std::vector<Candidate> candidates;
+    for(int digram = 0; digram < (1 << 16); digram++)
+    {
+        if(digrams[digram] >= quint32(MIN_TOKEN_COUNT))
+        {
+            char bytes[2] = {char(digram >> 8), char(digram)};
+            candidates.push_back({QByteArray(bytes, 2), digrams[digram]});
+        }
+    }
+    for(QHash<quint32, quint32>::const_iterator it = trigrams.constBegin(); it != trigrams.constEnd(); ++it)
+    {
+        if(it.value() >= quint32(MIN_TOKEN_COUNT))
+        {
+            char bytes[3] = {char(it.key() >> 16), char(it.key() >> 8), char(it.key())};
+            candidates.push_back({QByteArray(bytes, 3), 2*quint64(it.value())});
+        }
+    }
+    for(QHash<QByteArray, quint32>::const_iterator it = words.constBegin(); it != words.constEnd(); ++it)
+    {
+        if(it.value() >= quint32(MIN_TOKEN_COUNT))
+            candidates.push_back({it.key(), quint64(it.key().size() - 1)*it.value()});
+    }
+
+    int max_tokens = qBound(0, p_max_tokens, int(MAX_TOKENS));
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+        return a.score != b.score ? a.score > b.score : a.bytes < b.bytes;     //deterministic order
+    });
+    if(candidates.size() > size_t(max_tokens))
+        candidates.resize(size_t(max_tokens));
+
+    SFTokenAlphabet chosen;
+    for(const Candidate& candidate:candidates)
+        chosen.addToken(candidate.bytes.constData(), candidate.bytes.size());
+    chosen.index();
+
+    QVector<int> uses(chosen.size(), 0);
+    for(int symbol:chosen.tokenize(p_data, size))
+        uses[symbol]++;
+
+    SFTokenAlphabet result;
+    for(int symbol = BYTES; symbol < chosen.size(); symbol++)
+    {
+        if(uses.at(symbol) >= MIN_TOKEN_COUNT)
+            result.addToken(chosen.bytes(symbol), chosen.length(symbol));
+    }
+    result.index();
+    return result;
+}
+
+/**
+ * @brief SFTokenAlphabet::tokenize replaces the input by symbols of the alphabet
+ * @return the symbols, at every position the longest matching token or the byte
+ */
+QVector<int> SFTokenAlphabet::tokenize(const char* p_data, qint64 p_size) const
+{
+    QVector<int> result;
+    result.reserve(int(p_size/2));
+
+    qint64 i = 0;
+    while(i < p_size)
+    {
+        int symbol = uchar(p_data[i]);
+        if(i + 1 < p_size)
+        {
+            int b = bucket(p_data + i);
+            for(int k = m_bucket_begin.at(b); k < m_bucket_begin.at(b + 1); k++)
+            {
+                int token = m_by_bucket.at(k);
+                if(length(token) <= p_size - i && std::memcmp(p_data + i, bytes(token), size_t(length(token))) == 0)
+                {
+                    symbol = token;
+                    break;
+                }
+            }
+        }
+        result.append(symbol);
+        i += length(symbol);
+    }
+    return result;
+}
+
+/**
+ * @brief SFTokenAlphabet::write writes the tokens (the bytes are implicit)
+ */
+void SFTokenAlphabet::write(SFBitWriter& p_writer) const
+{
+    p_writer.writeBits(quint64(tokens()), 16);
+    for(int symbol = BYTES; symbol < size(); symbol++)
+    {
+        p_writer.writeBits(quint64(length(symbol) - 1), 4);
+        for(int i = 0; i < length(symbol); i++)
+            p_writer.writeBits(uchar(bytes(symbol)[i]), 8);
+    }
+}
+
+/**
+ * @brief SFTokenAlphabet::read reads an alphabet written by SFTokenAlphabet::write()
+ * @return false if the data is corrupted
+ */
+bool SFTokenAlphabet::read(SFBitReader& p_reader, SFTokenAlphabet& p_alphabet)
+{
+    p_alphabet = SFTokenAlphabet();
+    int tokens = int(p_reader.readBits(16));
+    if(tokens > MAX_TOKENS)
+        return false;
+
+    char token[MAX_TOKEN_LENGTH];
+    for(int t = 0; t < tokens; t++)
+    {
+        int length = int(p_reader.readBits(4)) + 1;
+        if(length < 2 || p_reader.bitsLeft() < 8*length)
+            return false;
+        for(int i = 0; i < length; i++)
+            token[i] = char(p_reader.readBits(8));
+        p_alphabet.addToken(token, length);
+    }
+    p_alphabet.index();
+    return true;
+}
+
+/**
+ * @brief SFTokenAlphabet::addToken appends a symbol (call index() when all are added)
+ */
+void SFTokenAlphabet::addToken(const char* p_bytes, int p_length)
+{
+    Q_ASSERT(p_length > 0 && p_length <= MAX_TOKEN_LENGTH);
+
+    QByteArray slot(MAX_TOKEN_LENGTH, '\0');
+    std::memcpy(slot.data(), p_bytes, size_t(p_length));
+    m_slots.append(slot);
+    m_lengths.append(quint8(p_length));
+}
+
+/**
+ * @brief SFTokenAlphabet::index groups the tokens by their first two bytes for tokenize()
+ */
+void SFTokenAlphabet::index()
+{
+    m_by_bucket.clear();
+    for(int symbol = BYTES; symbol < size(); symbol++)
+        m_by_bucket.append(symbol);
+    std::stable_sort(m_by_bucket.begin(), m_by_bucket.end(), [this](int a, int b) {
+        int bucket_a = bucket(bytes(a)), bucket_b = bucket(bytes(b));
+        return bucket_a != bucket_b ? bucket_a < bucket_b : length(a) > length(b);
+    });
+
+    m_bucket_begin.fill(0, (1 << 16) + 1);
+    for(int symbol:m_by_bucket)
+        m_bucket_begin[bucket(bytes(symbol)) + 1]++;
+    for(int b = 0; b < (1 << 16); b++)
+        m_bucket_begin[b + 1] += m_bucket_begin.at(b);
+}
+
+
+SFTokenEncoder::SFTokenEncoder():
+    m_builder(&SFCodeBuilder::shannonFano()),
+    m_max_tokens(SFTokenAlphabet::DEFAULT_TOKENS)
+{
+
+}
+
+/**
+ * @brief SFTokenEncoder::encode builds an alphabet for p_input and encodes it
+ */
+QByteArray SFTokenEncoder::encode(const QByteArray& p_input) const
+{
+    SFTokenAlphabet alphabet = SFTokenAlphabet::build(p_input.constData(), p_input.size(), m_max_tokens);
+    QVector<int> symbols = alphabet.tokenize(p_input.constData(), p_input.size());
+
+    QVector<quint64> histogram(alphabet.size(), 0);
+    for(int symbol:symbols)
+        histogram[symbol]++;
+    SFCodeTable table = SFCodeTable::fromHistogram(histogram, *m_builder);
+
+    QByteArray result;
+    SFBitWriter writer(&result);
+    writer.writeBits(quint32(p_input.size()), 32);
+    writer.writeBits(quint32(symbols.size()), 32);
+    alphabet.write(writer);
+    if(!symbols.isEmpty())
+        table.write(writer);
+    writer.flush();
+
+    for(int symbol:symbols)
+        table.encode(writer, symbol);
+    writer.flush();
+    return result;
+}
+
+
+/**
+ * @brief SFTokenDecoder::decode decodes the output of SFTokenEncoder
+ * @return the decoded data or an empty array if the input is corrupted
+ */
+QByteArray SFTokenDecoder::decode(const QByteArray& p_input)
+{
+    qint64 size = decodedSize(p_input.constData(), p_input.size());
+    if(size <= 0 || size > std::numeric_limits<int>::max())
+        return QByteArray();
+
+    QByteArray result;
+    result.resize(int(size));
+    if(decode(p_input.constData(), p_input.size(), result.data(), size) != size)
+        return QByteArray();
+    return result;
+}
+
+/**
+ * @brief SFTokenDecoder::decode decodes the output of SFTokenEncoder into a caller owned buffer
+ * @return the decoded size or -1 if the input is corrupted or p_out is too small
+ *
+ * Every decoded symbol is copied from its slot in the alphabet with a memcpy of MAX_TOKEN_LENGTH
+ * bytes (a few instructions since the size is constant), only near the end of p_out with its length.
+ */
+qint64 SFTokenDecoder::decode(const char* p_input, qint64 p_size, char* p_out, qint64 p_capacity)
+{
+    qint64 size = decodedSize(p_input, p_size);
+    if(size < 0 || size > p_capacity)
+        return -1;
+
+    SFBitReader reader(p_input, p_size);
+    reader.skipBits(32);
+    quint32 count = quint32(reader.readBits(32));
+
+    SFTokenAlphabet alphabet;
+    if(!SFTokenAlphabet::read(reader, alphabet))
+        return -1;
+    SFCodeTable table(alphabet.size());
+    if(count > 0)
+    {
+        table = SFCodeTable::read(reader, alphabet.size());
+        if(table.isEmpty())
+            return -1;
+    }
+    reader.alignToByte();
+    if(reader.bytePos() > p_size)
+        return -1;
+
+    SFBitReader codes(p_input + reader.bytePos(), p_size - reader.bytePos());
+    const char* slots = alphabet.bytes(0);
+    char* out = p_out;
+    char* end = p_out + size;
+    for(quint32 i = 0; i < count; i++)
+    {
+        int symbol = table.decode(codes);
+        if(symbol < 0)
+            return -1;
+
+        int length = alphabet.length(symbol);
+        if(end - out >= SFTokenAlphabet::MAX_TOKEN_LENGTH)
+        {
+            std::memcpy(out, slots + symbol*SFTokenAlphabet::MAX_TOKEN_LENGTH, SFTokenAlphabet::MAX_TOKEN_LENGTH);
+        }
+        else
+        {
+            if(length > end - out)
+                return -1;
+            std::memcpy(out, slots + symbol*SFTokenAlphabet::MAX_TOKEN_LENGTH, size_t(length));
+        }
+        out += length;
+    }
+    return out == end ? size : -1;
+}
+
+/**
+ * @brief SFTokenDecoder::decodedSize reads the decoded size from the start of p_input
+ * @return the size or -1 if p_input is too short
+ */
+qint64 SFTokenDecoder::decodedSize(const char* p_input, qint64 p_size)
+{
+    if(p_size < 8)
+        return -1;
+    SFBitReader reader(p_input, p_size);
+    return qint64(reader.readBits(32));
+}
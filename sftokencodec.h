@@ -0,0 +1,91 @@
+#ifndef SFTOKENCODEC_H
+#define SFTOKENCODEC_H
+
+#include <QByteArray>
+#include <QVector>
+
+#include "sfcodetable.h"
+#include "sfbitstream.h"
+
+/**
+ * \class SFTokenAlphabet
+ * @brief Extends the 256 byte values by frequent multi-byte tokens (digrams, trigrams and words)
+ *
+ * Symbols 0-255 are the bytes, symbols from 256 on are tokens of 2 to MAX_TOKEN_LENGTH bytes.
+ * build() counts all digrams, trigrams and words (letters with the preceding space) of a sample
+ * of the input and picks the candidates that save the most symbols (count * (length - 1)).
+ *
+ * tokenize() replaces the input greedily by the longest token that matches at every position.
+ * The tokens are grouped by their first two bytes, so only a few of them are compared per position.
+ * Every symbol is stored in a slot of MAX_TOKEN_LENGTH bytes (padded with zeros), the decoder copies
+ * whole slots with a memcpy of constant size and only advances by the length of the symbol.
+ */
+class SFTokenAlphabet
+{
+public:
+    enum {BYTES = 256, MAX_TOKENS = 4096, MAX_TOKEN_LENGTH = 16, DEFAULT_TOKENS = 512, SAMPLE_SIZE = 1 << 20};
+
+    SFTokenAlphabet();
+
+    static SFTokenAlphabet build(const char* p_data, qint64 p_size, int p_max_tokens = DEFAULT_TOKENS);
+
+    int size() const {return m_lengths.size();}             //number of symbols (bytes and tokens)
+    int tokens() const {return size() - BYTES;}
+    int length(int p_symbol) const {return m_lengths.at(p_symbol);}
+    const char* bytes(int p_symbol) const {return m_slots.constData() + p_symbol*MAX_TOKEN_LENGTH;}
+
+    QVector<int> tokenize(const char* p_data, qint64 p_size) const;
+
+    void write(SFBitWriter& p_writer) const;
+    static bool read(SFBitReader& p_reader, SFTokenAlphabet& p_alphabet);
+
+private:
+    void addToken(const char* p_bytes, int p_length);
+    void index();
+    static int bucket(const char* p_bytes) {return (uchar(p_bytes[0]) << 8) | uchar(p_bytes[1]);}
+
+    QByteArray m_slots;         //MAX_TOKEN_LENGTH bytes per symbol
+    QVector<quint8> m_lengths;
+    QVector<int> m_bucket_begin;    //tokens starting with the two bytes b are m_by_bucket[m_bucket_begin[b]] to m_by_bucket[m_bucket_begin[b+1] - 1]
+    QVector<int> m_by_bucket;       //token symbols ordered by bucket, the longest first
+};
+
+/**
+ * \class SFTokenEncoder
+ * @brief Encodes data over a SFTokenAlphabet built for it
+ *
+ * The codes are assigned to the symbols of the extended alphabet like to bytes (a SFList
+ * of their counts split by the builder, see SFCodeTable::fromHistogram()), so frequent words
+ * get a single short code and every lookup of the decoder yields several bytes.
+ *
+ * Layout: decoded size (32 bits), number of symbols (32 bits), the alphabet (number of tokens (16 bits),
+ * then length - 1 (4 bits) and the bytes of every token), the table and at the next byte boundary the codes.
+ */
+class SFTokenEncoder
+{
+public:
+    SFTokenEncoder();
+
+    void setBuilder(const SFCodeBuilder& p_builder) {m_builder = &p_builder;}
+    void setMaxTokens(int p_tokens) {m_max_tokens = p_tokens;}  //0 - SFTokenAlphabet::MAX_TOKENS
+
+    QByteArray encode(const QByteArray& p_input) const;
+
+private:
+    const SFCodeBuilder* m_builder;
+    int m_max_tokens;
+};
+
+/**
+ * \class SFTokenDecoder
+ * @brief Decodes the output of SFTokenEncoder
+ */
+class SFTokenDecoder
+{
+public:
+    static QByteArray decode(const QByteArray& p_input);
+    static qint64 decode(const char* p_input, qint64 p_size, char* p_out, qint64 p_capacity);
+    static qint64 decodedSize(const char* p_input, qint64 p_size);
+};
+
+#endif // SFTOKENCODEC_H
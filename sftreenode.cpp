@@ -1,8 +1,35 @@
 #include "sftreenode.h"
 
-SFTreeNode::SFTreeNode(const SFList p_payload, std::shared_ptr<SFTreeNode> p_parent, std::size_t p_distance_to_root):
+#include <QElapsedTimer>
+
+/**
+ * @brief SFTreeNode::SFTreeNode creates the root of a tree holding all symbols of p_payload
+ * @param p_payload symbols sorted by their codes. The list is copied once and shared by all nodes of the tree
+ */
+SFTreeNode::SFTreeNode(const SFList& p_payload):
+    m_symbols(std::make_shared<SFList>(p_payload)),
+    m_offset(0),
+    m_length(p_payload.size()),
+    m_distance_to_root(0),
+    m_shortest_distance_to_leaf(0)
+{
+    m_symbols->detach();    //detach once now instead of in the first non-const access of a node
+    m_step_history = std::make_shared<TreeHistoryStack>();
+}
+
+/**
+ * @brief SFTreeNode::SFTreeNode creates a node whose payload is a range of the symbols of its tree
+ * @param p_symbols the symbols of the whole tree
+ * @param p_offset first symbol of the payload
+ * @param p_length number of symbols in the payload
+ * @param p_parent parent node
+ * @param p_distance_to_root distance of this node to the root
+ */
+SFTreeNode::SFTreeNode(std::shared_ptr<SFList> p_symbols, int p_offset, int p_length, std::shared_ptr<SFTreeNode> p_parent, std::size_t p_distance_to_root):
     m_parent(p_parent),
-    m_payload(p_payload),
+    m_symbols(p_symbols),
+    m_offset(p_offset),
+    m_length(p_length),
     m_distance_to_root(p_distance_to_root),
     m_shortest_distance_to_leaf(0)
 {
@@ -18,22 +45,24 @@ SFTreeNode::~SFTreeNode()
 
 /**
  * @brief SFTreeNode::setRightChild creates a right child with the given payload setting m_shortest_distance_to_leaf to 1
- * @param p_payload is the payload the child will be constructed with
+ * @param p_offset first symbol of the child's payload
+ * @param p_length number of symbols of the child's payload
  */
-void SFTreeNode::setRightChild(const SFList p_payload)
+void SFTreeNode::setRightChild(int p_offset, int p_length)
 {
-    m_right_child = std::make_shared<SFTreeNode>(p_payload, shared_from_this(), m_distance_to_root+1);
+    m_right_child = std::make_shared<SFTreeNode>(m_symbols, p_offset, p_length, shared_from_this(), m_distance_to_root+1);
     m_right_child->m_step_history = m_step_history;
     setShortestDistanceToLeaf(1);
 }
 
 /**
  * @brief SFTreeNode::setLeftChild creates a left child with the given payload setting m_shortest_distance_to_leaf to 1
- * @param p_payload is the payload the child will be constructed with
+ * @param p_offset first symbol of the child's payload
+ * @param p_length number of symbols of the child's payload
  */
-void SFTreeNode::setLeftChild(const SFList p_payload)
+void SFTreeNode::setLeftChild(int p_offset, int p_length)
 {
-    m_left_child = std::make_shared<SFTreeNode>(p_payload, shared_from_this(), m_distance_to_root+1);
+    m_left_child = std::make_shared<SFTreeNode>(m_symbols, p_offset, p_length, shared_from_this(), m_distance_to_root+1);
     m_left_child->m_step_history = m_step_history;
     setShortestDistanceToLeaf(1);
 }
@@ -52,14 +81,14 @@ bool SFTreeNode::step()
         result = smallStepToBigStep();                                       //it has to have been a small step and the tree
     }                                                               //might be in an unbalanced state
 
-    if(!result && m_payload.length() > 1)  //Node contains more than one Symbol it will be an inner node in the final tree therefore
+    if(!result && m_length > 1)  //Node contains more than one Symbol it will be an inner node in the final tree therefore
     {
-        SFList::iterator iter = SFList::split(m_payload.begin(), m_payload.end());  //the payload needs to be split into two
-        int pos = iter - m_payload.begin();
-        setLeftChild(m_payload.mid(0,pos));                                         //distributed to the two child nodes
-        setRightChild(m_payload.mid(pos));
-        m_payload.clear();                                                          //SFList::mid() constructs a copy
-        result = true;                                                              //so m_payload needs to be cleared
+        SFList::iterator iter = SFCodeBuilder::splitByCode(payloadBegin(), payloadEnd(), m_distance_to_root);  //the payload needs to be split into two
+        int pos = iter - payloadBegin();
+        setLeftChild(m_offset, pos);                                                //distributed to the two child nodes
+        setRightChild(m_offset + pos, m_length - pos);
+        m_length = 0;                                                               //the children own the range now
+        result = true;
         m_step_history->push(StepInstruction(shared_from_this(), BALANCED_NODE_SPLIT));
     }
     else
@@ -96,9 +125,10 @@ bool SFTreeNode::step_back()
         }
         else if(std::get<1>(last_step) == SYMBOL_L_TO_R)
         {
-          Symbol sym = node->m_parent->m_right_child->m_payload.first();
-          node->m_payload.push_back(sym);
-          node->m_parent->m_right_child->m_payload.pop_front();
+          std::shared_ptr<SFTreeNode> right_node = node->m_parent->m_right_child;
+          node->m_length++;                     //give the first symbol of the right sibling back
+          right_node->m_offset++;
+          right_node->m_length--;
         }
         m_step_history->pop();
         result = true;
@@ -117,9 +147,9 @@ bool SFTreeNode::smallStep()
     bool result = false;
     if(!m_left_child && !m_right_child) //first step of the process
     {                                   //all symbols in root
-        setLeftChild(m_payload);        //spawn children and put all symbols into the left node
-        setRightChild(SFList());        //balancing is done by smallStep_helper_left()
-        m_payload.clear();
+        setLeftChild(m_offset, m_length);           //spawn children and put all symbols into the left node
+        setRightChild(m_offset + m_length, 0);      //balancing is done by smallStep_helper_left()
+        m_length = 0;
         result = true;
 
         m_step_history->push(StepInstruction(shared_from_this(), NODE_SPLIT));
@@ -161,16 +191,10 @@ bool SFTreeNode::smallStepToBigStep()
     else
     {
         std::shared_ptr<SFTreeNode> left_node = std::get<0>(last_step);
-        std::shared_ptr<SFTreeNode> right_node = left_node->m_parent->m_right_child;
-        double balance = left_node->m_parent->balance();
-        double balance_after_sym_shift = 2*left_node->m_payload.last().getProb();
 
-        while(std::abs(balance) > std::abs(balance_after_sym_shift))
+        while(left_node->m_length > 1 && left_node->belongsToRight(left_node->payloadLast()))
         {
-            right_node->m_payload.push_front(left_node->m_payload.last());
-            left_node->m_payload.pop_back();
-            balance = left_node->m_parent->balance();
-            balance_after_sym_shift = 2*left_node->m_payload.last().getProb();
+            left_node->moveLastToRight();
 
             result = true;
             m_step_history->push(StepInstruction(left_node, SYMBOL_L_TO_R));
@@ -186,10 +210,15 @@ bool SFTreeNode::smallStepToBigStep()
  * @param p_root is the starting point of the tree that is to be drawn
  * @param p_width is the width the resulting QImage should have
  * @param p_height is the height the resulting QImage should have
+ * @param p_stats if given it is set to the time spent in depth() and in painting
  * @return QImage depicting the tree starting at the given root
  */
-QImage SFTreeNode::drawTree(std::shared_ptr<SFTreeNode> p_root, int p_width, int p_height)
+QImage SFTreeNode::drawTree(std::shared_ptr<SFTreeNode> p_root, int p_width, int p_height, DrawStats* p_stats)
 {
+    QElapsedTimer timer;
+    timer.start();
+    qint64 depth_nsecs = 0;
+
     int treeWidth = p_width-10,
         treeHeight = p_height-24,
         step_x = treeWidth/4,
@@ -208,12 +237,21 @@ QImage SFTreeNode::drawTree(std::shared_ptr<SFTreeNode> p_root, int p_width, int
         painter.setPen(QPen(QColor(0,0,0)));
         painter.setRenderHint(QPainter::Antialiasing);
 
+        QElapsedTimer depth_timer;
+        depth_timer.start();
         depth = p_root->depth();
+        depth_nsecs = depth_timer.nsecsElapsed();
         if(!depth)
             depth = 1;
 
         step_y = treeHeight/depth;
-        p_root->draw(painter, p1, step_y, step_x);
+        p_root->draw(painter, p1, step_y, step_x, p_root->sumBranch());
+    }
+
+    if(p_stats)
+    {
+        p_stats->depth_nsecs = depth_nsecs;
+        p_stats->paint_nsecs = timer.nsecsElapsed() - depth_nsecs;
     }
     return image;
 }
@@ -224,8 +262,9 @@ QImage SFTreeNode::drawTree(std::shared_ptr<SFTreeNode> p_root, int p_width, int
  * @param p_start QPoint containing the position where this node should be drawn
  * @param p_distance_v vertical distance to children
  * @param p_distance_h horizontal distance to children
+ * @param p_total sum of the counts of the whole tree. The labels show the probability of a branch (count/p_total)
  */
-void SFTreeNode::draw(QPainter& p_painter, QPoint p_start, int p_distance_v, int p_distance_h) const
+void SFTreeNode::draw(QPainter& p_painter, QPoint p_start, int p_distance_v, int p_distance_h, qint64 p_total) const
 {
     QPoint p_end;
     if(m_left_child)
@@ -238,12 +277,12 @@ void SFTreeNode::draw(QPainter& p_painter, QPoint p_start, int p_distance_v, int
             p_painter.setPen(QPen(QColor(200,200,200)));
 
             p_painter.drawText(p_start + 0.25*(p_end - p_start) + QPoint(-35,0),
-                               QString::number(m_left_child->sumBranch(), 'f', 3).right(4));
+                               QString::number((double)m_left_child->sumBranch()/(double)p_total, 'f', 3).right(4));
 
             p_painter.setPen(QPen(QColor(0,0,0)));
         }
 
-        m_left_child->draw(p_painter, p_end, p_distance_v, p_distance_h/2);
+        m_left_child->draw(p_painter, p_end, p_distance_v, p_distance_h/2, p_total);
     }
 
     if(m_right_child)
@@ -255,17 +294,18 @@ void SFTreeNode::draw(QPainter& p_painter, QPoint p_start, int p_distance_v, int
         {
             p_painter.setPen(QPen(QColor(200,200,200)));
             p_painter.drawText(p_start + 0.25*(p_end - p_start) + QPoint(5,0),
-                               QString::number(m_right_child->sumBranch(), 'f', 3).right(4));
+                               QString::number((double)m_right_child->sumBranch()/(double)p_total, 'f', 3).right(4));
 
             p_painter.setPen(QPen(QColor(0,0,0)));
         }
-        m_right_child->draw(p_painter, p_end, p_distance_v, p_distance_h/2);
+        m_right_child->draw(p_painter, p_end, p_distance_v, p_distance_h/2, p_total);
     }
     else                                    //no children => current node is a leaf => draw it's symbol
     {
         QString str;
-        for(Symbol sym:m_payload)
+        for(SFList::iterator iter = payloadBegin(); iter != payloadEnd(); ++iter)
         {
+            const Symbol& sym = *iter;
             if(sym.getSym() == ' ')
                 str += "'_'";
             else
@@ -302,14 +342,13 @@ void SFTreeNode::setDistanceToRoot(size_t p_distance)
 }
 
 /**
- * @brief SFTreeNode::sumBranch return the sum of all symbols this node and all its children contain
- * @return sum of all symbols this node and all its children contain
+ * @brief SFTreeNode::sumBranch return the sum of the counts of all symbols this node and all its children contain
+ * @return sum of the counts of all symbols this node and all its children contain
  */
-double SFTreeNode::sumBranch() const
+qint64 SFTreeNode::sumBranch() const
 {
-    double result = 0;
-    for(Symbol sym:m_payload)
-        result += sym.getProb();
+    callCounts().sum_branch++;
+    qint64 result = SFList::sum(payloadBegin(), payloadEnd());
     if(m_right_child)
         result += m_right_child->sumBranch();
     if(m_left_child)
@@ -319,30 +358,32 @@ double SFTreeNode::sumBranch() const
 
 /**
  * @brief SFTreeNode::killChildren merges the children's payload into this one and destroys all children of this node
+ *
+ * The ranges of the children are adjacent and the left one starts at m_offset, so merging only adds up the lengths.
  */
 void SFTreeNode::killChildren()
 {
     if(m_left_child)
     {
         m_left_child->killChildren();
-        m_payload += m_left_child->m_payload;
+        m_length += m_left_child->m_length;
         m_left_child.reset();
     }
     if(m_right_child)
     {
         m_right_child->killChildren();
-        m_payload += m_right_child->m_payload;
+        m_length += m_right_child->m_length;
         m_right_child.reset();
     }
 }
 
 /**
  * @brief SFTreeNode::balance gives the difference between the sum of the right child tree substracted from the sum of the left child tree
- * @return difference between the two child trees
+ * @return difference between the counts of the two child trees
  */
-double SFTreeNode::balance() const
+qint64 SFTreeNode::balance() const
 {
-    double result = 0;
+    qint64 result = 0;
     if(m_left_child)
         result += m_left_child->sumBranch();
     if(m_right_child)
@@ -356,6 +397,7 @@ double SFTreeNode::balance() const
  */
 std::size_t SFTreeNode::depth()
 {
+    callCounts().depth++;
     std::size_t depth_left = 0;
     std::size_t depth_right = 0;
     if(m_left_child)
@@ -372,6 +414,54 @@ std::size_t SFTreeNode::depth()
     return (depth_left > depth_right)?(depth_left):(depth_right);   //return the bigge of the wo values
 }
 
+/**
+ * @brief SFTreeNode::nodeCount returns the number of nodes of the tree starting at this node
+ */
+std::size_t SFTreeNode::nodeCount() const
+{
+    std::size_t result = 1;
+    if(m_left_child)
+        result += m_left_child->nodeCount();
+    if(m_right_child)
+        result += m_right_child->nodeCount();
+    return result;
+}
+
+/**
+ * @brief SFTreeNode::callCounts returns how often sumBranch() and depth() were called so far
+ *
+ * The tree is only used by the GUI thread so the counters are plain integers. Callers
+ * take the difference of two readings.
+ */
+SFTreeNode::CallCounts& SFTreeNode::callCounts()
+{
+    static CallCounts counts = {0, 0};
+    return counts;
+}
+
+/**
+ * @brief SFTreeNode::moveLastToRight moves the last symbol of this (left) node to the front of the right sibling
+ *
+ * The symbol stays where it is in m_symbols, only the boundary between the two ranges moves.
+ */
+void SFTreeNode::moveLastToRight()
+{
+    std::shared_ptr<SFTreeNode> right_node = m_parent->m_right_child;
+    m_length--;
+    right_node->m_offset--;
+    right_node->m_length++;
+}
+
+/**
+ * @brief SFTreeNode::belongsToRight checks if a symbol of this (left) node belongs to the right sibling
+ * @param p_sym symbol of this node's payload
+ * @return true if the code of p_sym has a '1' at the position of the parent's branch
+ */
+bool SFTreeNode::belongsToRight(const Symbol& p_sym) const
+{
+    return m_distance_to_root > 0 && p_sym.getCode().at(m_distance_to_root-1) == '1';
+}
+
 /**
  * @brief SFTreeNode::smallStep_helper_left is called if this node should make a (small) step and it is the left child of its parent node
  * @return  true if the tree was modified in this node or one of it's children. false elswise
@@ -379,22 +469,20 @@ std::size_t SFTreeNode::depth()
 bool SFTreeNode::smallStep_helper_left()
 {
     bool result = false;
-    if(m_payload.length() > 1)      //leaf of the tree in it's current form but not a leaf of the final tree (leafs only hold 1 symbol)
+    if(m_length > 1)      //leaf of the tree in it's current form but not a leaf of the final tree (leafs only hold 1 symbol)
     {
-        double balance = m_parent->balance();
-        if(std::abs(balance) > std::abs(balance - (2*m_payload.last().getProb())))  //if the balance can be improved do so
+        if(belongsToRight(payloadLast()))                                           //move symbols until the split of the code is reached
         {
-            m_parent->m_right_child->m_payload.push_front(m_payload.last());
-            m_payload.pop_back();
+            moveLastToRight();
             result = true;
 
             m_step_history->push(StepInstruction(shared_from_this(), SYMBOL_L_TO_R));
         }
         else                                                                        //otherwise add children
         {
-            setLeftChild(m_payload);
-            setRightChild(SFList());
-            m_payload.clear();
+            setLeftChild(m_offset, m_length);
+            setRightChild(m_offset + m_length, 0);
+            m_length = 0;
             result = true;
 
             m_step_history->push(StepInstruction(shared_from_this(), NODE_SPLIT));
@@ -417,11 +505,11 @@ bool SFTreeNode::smallStep_helper_left()
 bool SFTreeNode::smallStep_helper_right()
 {
     bool result = false;
-    if(m_payload.length() > 1)      //when we arrive on a right branch the balancing has already happened
+    if(m_length > 1)                //when we arrive on a right branch the balancing has already happened
     {                               //if there are more than one character in this node it can't be a leaf
-        setLeftChild(m_payload);    //of the final tree so we need to add more children
-        setRightChild(SFList());
-        m_payload.clear();
+        setLeftChild(m_offset, m_length);           //of the final tree so we need to add more children
+        setRightChild(m_offset + m_length, 0);
+        m_length = 0;
         result = true;
 
         m_step_history->push(StepInstruction(shared_from_this(), NODE_SPLIT));
@@ -9,6 +9,7 @@
 #include <tuple>
 
 #include "sflist.h"
+#include "sfcodebuilder.h"
 
 
 class SFTreeNode;
@@ -16,6 +17,13 @@ class SFTreeNode;
 
 /**
  * @brief The SFTreeNode class is a simple binary tree implementation with special functionality for the Shannon Fano coding
+ *
+ * The payload has to be sorted by the codes (see SFCodeBuilder). Nodes are split where the codes of
+ * their symbols differ, so the tree shows the codes of whichever builder assigned them.
+ *
+ * All nodes of a tree share one copy of the sorted symbols. A node only stores the range
+ * [m_offset, m_offset+m_length) of its payload. Splits, merges and moving a symbol to the right
+ * sibling keep the ranges of siblings adjacent, so they only move the boundaries and never copy symbols.
  */
 class SFTreeNode: public std::enable_shared_from_this<SFTreeNode>
 {
@@ -27,12 +35,31 @@ private:
     enum {SYMBOL_L_TO_R, NODE_SPLIT, BALANCED_NODE_SPLIT};
 
 public:
-    SFTreeNode(const SFList p_payload, std::shared_ptr<SFTreeNode> p_parent = 0, std::size_t p_distance_to_root = 0);
+    /**
+     * @brief The CallCounts struct counts the calls of the recursive queries (read by SFFrameStats)
+     */
+    struct CallCounts
+    {
+        qint64 sum_branch;
+        qint64 depth;
+    };
+
+    /**
+     * @brief The DrawStats struct holds how long the parts of drawTree() took
+     */
+    struct DrawStats
+    {
+        qint64 depth_nsecs;     //depth() of the root
+        qint64 paint_nsecs;     //sumBranch() of the root and drawing the nodes
+    };
+
+    explicit SFTreeNode(const SFList& p_payload);
+    SFTreeNode(std::shared_ptr<SFList> p_symbols, int p_offset, int p_length, std::shared_ptr<SFTreeNode> p_parent, std::size_t p_distance_to_root);
 
     ~SFTreeNode();
 
-    void setRightChild(const SFList p_payload);
-    void setLeftChild(const SFList p_payload);
+    void setRightChild(int p_offset, int p_length);
+    void setLeftChild(int p_offset, int p_length);
 
     bool step();
     bool step_back();
@@ -41,19 +68,27 @@ public:
     std::size_t getShortestDistanceToLeaf() const {return m_shortest_distance_to_leaf;}
     std::size_t getDistanceToRoot() const {return m_distance_to_root;}
 
-    double sumBranch() const;
-    double balance() const;
+    qint64 sumBranch() const;
+    qint64 balance() const;
 
     std::size_t depth();
-    static QImage drawTree(std::shared_ptr<SFTreeNode> root, int width, int height);
+    std::size_t nodeCount() const;
+    static QImage drawTree(std::shared_ptr<SFTreeNode> root, int width, int height, DrawStats* p_stats = 0);
+    static CallCounts& callCounts();
 
 private:
 
-    void draw(QPainter& p_img, QPoint p_start, int p_distance_v, int p_distance_h) const;
+    void draw(QPainter& p_img, QPoint p_start, int p_distance_v, int p_distance_h, qint64 p_total) const;
     void killChildren();
     void setShortestDistanceToLeaf(size_t p_distance);
     void setDistanceToRoot(size_t p_distance);
 
+    SFList::iterator payloadBegin() const {return m_symbols->begin() + m_offset;}
+    SFList::iterator payloadEnd() const {return payloadBegin() + m_length;}
+    const Symbol& payloadLast() const {return *(payloadEnd() - 1);}
+    void moveLastToRight();
+
+    bool belongsToRight(const Symbol& p_sym) const;
     bool smallStep_helper_left();
     bool smallStep_helper_right();
     bool smallStepToBigStep();
@@ -62,7 +97,9 @@ private:
     std::shared_ptr<SFTreeNode> m_left_child;
     std::shared_ptr<SFTreeNode> m_right_child;
 
-    SFList m_payload;
+    std::shared_ptr<SFList> m_symbols;     //sorted symbols of the whole tree
+    int m_offset;                           //first symbol of this node's payload in m_symbols
+    int m_length;                           //number of symbols in the payload, 0 for inner nodes
 
     std::size_t m_distance_to_root;
     std::size_t m_shortest_distance_to_leaf;
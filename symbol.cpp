@@ -5,9 +5,15 @@
 Symbol::Symbol(QChar p_sym):sym(p_sym),count(-1),prob(0),code(""){}
 
 
+/**
+ * @brief Symbol::operator < sorts symbols from the highest to the lowest count and equal counts by their value
+ *
+ * This is the order SFList::sortByCount() produces. The count is used instead of the probability
+ * so the order does not depend on floating point rounding
+ */
 bool Symbol::operator < (const Symbol& str) const
 {
-        return (str.prob < prob);
+        return (str.count < count) || (str.count == count && sym < str.sym);
 }
 
 bool Symbol::operator == (const QChar& p_sym) const